@@ -0,0 +1,88 @@
+/*
+ * explored list of the high-level search, open addressing with linear probing
+ * keys are configurations stored in the nodes themselves
+ */
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "graph.hpp"
+#include "utils.hpp"
+
+struct Node;
+
+struct ClosedTable {
+  struct Slot {
+    uint64_t hash;  // cached hash of node->C
+    Node* node;     // nullptr -> empty
+  };
+
+  const ConfigLayout* layout;  // to compare configurations
+  Config C_buf;                // buffer to unpack stored configurations
+
+  std::vector<Slot> slots;  // |slots| is a power of two
+  size_t num;               // number of stored nodes
+
+  // statistics
+  size_t num_lookups;
+  size_t num_probes;
+  size_t max_probe_length;
+
+  ClosedTable(const ConfigLayout* _layout, size_t initial_capacity = 1024);
+
+  Node* find(const Config& C, uint64_t hash);
+  void insert(Node* S, uint64_t hash);  // assuming S->C is not stored
+  void clear();
+
+  size_t size() const { return num; }
+  double load_factor() const;
+  double average_probe_length() const;
+
+private:
+  void grow();
+};
+
+// explored list shared by workers of the parallel search
+// sharded by the upper bits of hashes, each shard is guarded by its own mutex
+struct ConcurrentClosedTable {
+  static constexpr int SHARD_BITS = 6;
+
+  struct Shard {
+    std::mutex mutex;
+    ClosedTable table;
+    Shard(const ConfigLayout* layout, size_t capacity)
+        : mutex(), table(layout, capacity)
+    {
+    }
+  };
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  ConcurrentClosedTable(const ConfigLayout* _layout,
+                        size_t initial_capacity = 1 << 16);
+
+  // returns the stored node and whether it is created by create()
+  // create() runs outside the lock, since it may run BFS of distance tables;
+  // if another thread inserts the same configuration meanwhile, that node is
+  // returned with false, the created one is left to the caller
+  template <typename F>
+  std::pair<Node*, bool> find_or_insert(const Config& C, uint64_t hash,
+                                        F create)
+  {
+    auto& shard = *shards[hash >> (64 - SHARD_BITS)];
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto S = shard.table.find(C, hash);
+      if (S != nullptr) return {S, false};
+    }
+    auto S_new = create();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto S = shard.table.find(C, hash);  // re-check
+    if (S != nullptr) return {S, false};
+    shard.table.insert(S_new, hash);
+    return {S_new, true};
+  }
+  void clear();
+
+  size_t size() const;  // not synchronized, after search
+};
@@ -0,0 +1,40 @@
+/*
+ * on-disk cache of complete distance tables, keyed by graph and goal vertex
+ * file: <dir>/<graph hash>-<goal vertex id>.dist, header + K distances
+ */
+#pragma once
+
+#include "graph.hpp"
+#include "utils.hpp"
+
+struct DistCache {
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t K;  // number of vertices
+    uint64_t graph_hash;
+    uint32_t goal_id;
+    uint32_t width;  // bytes per distance
+  };
+
+  const std::string dir;
+  const uint64_t graph_hash;
+  const int K;
+
+  DistCache(const std::string& _dir, const Graph& G);
+  ~DistCache();
+  DistCache(const DistCache&) = delete;
+  DistCache& operator=(const DistCache&) = delete;
+
+  // read-only memory mapping, nullptr if not cached
+  const uint8_t* load(int goal_id, int width);
+  // write back a complete table, safe to call concurrently for different goals
+  bool store(int goal_id, const uint8_t* dists, int width) const;
+  // take over mappings of a replaced cache, tables may still refer to them
+  void adopt(DistCache& other);
+
+  std::string get_filename(int goal_id) const;
+
+private:
+  std::vector<std::pair<void*, size_t>> mappings;  // for munmap
+};
@@ -1,26 +1,123 @@
 /*
  * distance table with lazy evaluation, using BFS
+ * tables are shared among agents with the same goal vertex
+ *
+ * with concurrent = true, one table can be used by many threads
+ * - set entries are final in BFS, they are read without locks
+ * - BFS resumption is serialized per table by its mutex
+ * - tables must be created before sharing, e.g., in the constructor
+ *
+ * goals can be appended and retired in lifelong operation, while not shared
+ * tables are reference-counted and released once no sequence uses them
  */
 #pragma once
 
+#include <mutex>
+
+#include "dist_cache.hpp"
 #include "graph.hpp"
 #include "instance.hpp"
 #include "utils.hpp"
 
+// eager computation of tables before search
+enum class Precompute {
+  NONE,         // fully lazy
+  FIRST_GOALS,  // the first goal of every agent
+  ALL_GOALS,    // every goal in the sequences
+};
+
 struct DistTableMultiGoal {
-  const int K;  // number of vertices
-  std::vector<std::vector<std::vector<int>>>
-      table;  // distance table, index: agent-id, goal_index, vertex-id
-  std::vector<std::vector<std::queue<Vertex*>>> OPEN;  // search queues
+  // representation of each table
+  enum class Storage : uint8_t {
+    U16,    // uint16 per vertex
+    U32,    // uint32 per vertex
+    BLOCK,  // uint32 base per block + uint8 delta per vertex, read-only
+  };
+  static constexpr int BLOCK_SIZE = 64;
+
+  const Graph* G;
+  const int K;             // number of vertices
+  const int width;         // bytes per distance, c.f., get_width
+  bool compress_finished;  // compress tables when BFS completes, unless shared
+  bool concurrent;         // shared among threads, c.f., the top
+  std::vector<std::vector<uint8_t>>
+      table;  // distance table, index: table-id, c.f., storage
+  std::vector<const uint8_t*> dists;  // table or cached one, index: table-id
+  std::vector<Storage> storage;       // index: table-id
+  std::vector<std::queue<uint32_t>> OPEN;  // vertex ids, index: table-id
+  Vertices goals;                          // table-id -> goal vertex
+  std::vector<std::vector<int>>
+      table_ids;  // index: agent-id, goal_index -> table-id
+  std::vector<int> goal_table_ids;  // goal vertex-id -> table-id, -1 if none
+  std::vector<int> num_refs;        // index: table-id, uses in table_ids
+  std::vector<int> free_ids;        // released table-ids, reused first
+  std::unique_ptr<DistCache> cache;  // nullptr -> not used
+  std::vector<std::unique_ptr<std::mutex>> locks;  // index: table-id
 
   int get(int agent_id, int goal_index, int from_id);
+  // goal vertex of get(), i.e., where the distance is zero
+  inline Vertex* get_goal(int agent_id, int goal_index) const
+  {
+    return goals[find_table_id(agent_id, goal_index)];
+  }
+  int find_table_id(int agent_id, int goal_index) const;
   inline int get(int agent_id, int goal_index, Vertex* from)
   {
     return get(agent_id, goal_index, from->id);
   }
 
+  // stored value, K -> not computed yet or unreachable
+  // plain tables may be filled concurrently, hence atomic loads
+  inline int read(int id, int v_id) const
+  {
+    const auto p = dists[id];
+    switch (storage[id]) {
+      case Storage::U16: {
+        const auto d = __atomic_load_n(
+            reinterpret_cast<const uint16_t*>(p) + v_id, __ATOMIC_RELAXED);
+        return d == UINT16_MAX ? K : d;
+      }
+      case Storage::U32: {
+        const auto d = __atomic_load_n(
+            reinterpret_cast<const uint32_t*>(p) + v_id, __ATOMIC_RELAXED);
+        return d == UINT32_MAX ? K : d;
+      }
+      default: {
+        const auto delta = p[num_blocks() * sizeof(uint32_t) + v_id];
+        if (delta == UINT8_MAX) return K;
+        return reinterpret_cast<const uint32_t*>(p)[v_id / BLOCK_SIZE] + delta;
+      }
+    }
+  }
+
   DistTableMultiGoal(const Instance* ins);
   DistTableMultiGoal(const Instance& ins) : DistTableMultiGoal(&ins) {}
+  // 2 if distances fit in uint16 besides the unreached value, otherwise 4
+  static int get_width(const Graph& G);
+
+  void setup(const Instance* ins);  // (re-)initialization of goal sequences
+  int get_table_id(Vertex* g);      // create a table for a new goal vertex
+  int acquire(Vertex* g);           // get_table_id with a new reference
+  void release(int id);             // drop a reference, maybe the table
+
+  // goal sequences in lifelong operation
+  void append_goals(int agent_id, const Vertices& goal_sequence);
+  // goals before goal_index are passed, the last one is always kept
+  void retire_goals(int agent_id, int goal_index);
+  int resume_bfs(int id, int from_id = -1);  // -1 -> until the end
+  void finish(int id);                       // called once BFS completes
+
+  // complete BFS of tables in parallel, returns elapsed time in ms
+  double precompute(Precompute policy, int num_threads = 0);
+  size_t num_tables() const { return table.size() - free_ids.size(); }
+
+  // load cached tables and write back complete ones to dir
+  void use_cache(const std::string& dir, const Graph& G);
+  bool load_cache(int id);
 
-  void setup(const Instance* ins);  // initialization
+  // block-wise base + delta encoding of a complete table
+  // false if some block spans more than 254 distinct distances
+  bool compress(int id);
+  int num_blocks() const { return (K + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+  size_t get_memory_usage() const;  // bytes of owned tables
 };
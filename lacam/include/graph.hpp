@@ -2,12 +2,64 @@
  * graph definition
  */
 #pragma once
+#include <atomic>
+#include <mutex>
+
 #include "utils.hpp"
 
+struct Vertex;
+struct Graph;
+
+// adjacent vertices, a view to the CSR arrays of the graph
+class Neighbors
+{
+public:
+  class iterator
+  {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Vertex*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Vertex**;
+    using reference = Vertex*;
+
+    iterator(const uint32_t* _p, const Graph* _G) : p(_p), G(_G) {}
+    Vertex* operator*() const;
+    iterator& operator++()
+    {
+      ++p;
+      return *this;
+    }
+    bool operator==(const iterator& other) const { return p == other.p; }
+    bool operator!=(const iterator& other) const { return p != other.p; }
+
+  private:
+    const uint32_t* p;
+    const Graph* G;
+  };
+
+  Neighbors() : first(nullptr), last(nullptr), G(nullptr) {}
+  Neighbors(const uint32_t* _first, const uint32_t* _last, const Graph* _G)
+      : first(_first), last(_last), G(_G)
+  {
+  }
+
+  iterator begin() const { return iterator(first, G); }
+  iterator end() const { return iterator(last, G); }
+  size_t size() const { return last - first; }
+  bool empty() const { return first == last; }
+  Vertex* operator[](size_t k) const;
+
+private:
+  const uint32_t* first;
+  const uint32_t* last;
+  const Graph* G;  // to resolve ids
+};
+
 struct Vertex {
   const int id;     // index for V in Graph
   const int index;  // index for U (width * y + x) in Graph
-  std::vector<Vertex*> neighbor;
+  Neighbors neighbor;
 
   Vertex(int _id, int _index);
 };
@@ -68,23 +120,200 @@ private:
 
 std::ostream& operator<<(std::ostream& os, const Config& c);
 
+// three representations with the same interface (size, get_vertex, get_id,
+// get_index, for_each_neighbor), c.f., Storage
+// in implicit and mapped ones, vertices are created on demand
 struct Graph {
-  Vertices V;  // without nullptr
-  Vertices U;  // with nullptr, i.e., |U| = width * height
+  enum class Storage : uint8_t {
+    EXPLICIT,  // every vertex is materialized, adjacency is in CSR format
+    IMPLICIT,  // 4-connected grid of an obstacle bitmap, for very large maps
+               // vertex ids are ranks of free cells
+    MAPPED,    // memory-mapped binary graph file, c.f., save_binary
+  };
+  static constexpr int BLOCK_BITS = 5;  // vertices per block, created lazily
+  static constexpr int BLOCK_SIZE = 1 << BLOCK_BITS;
+
+  Storage storage;
+  int num_vertices;
+  int max_degree;
+
+  // adjacency in CSR format, owned (explicit) or mapped, nullptr if implicit
+  // i.e., neighbors of id are adj[adj_offsets[id]..adj_offsets[id + 1])
+  const uint32_t* adj_offsets;
+  const uint32_t* adj;
+
+  // explicit storage, vertices are contiguous
+  std::vector<Vertex> vertices;
+
+  // implicit storage
+  std::vector<uint64_t> free_bits;   // cell index -> free or not
+  std::vector<uint32_t> free_rank;   // word -> number of free cells before it
+  std::vector<uint32_t> block_head;  // block -> cell index of its first vertex
+
+  // mapped storage
+  const uint32_t* indexes;  // id -> cell index, ascending
+
+  // roadmaps are stored as explicit graphs of width |V| and height one,
+  // i.e., index = id, with optional coordinates for logs
+  std::vector<std::pair<int, int>> coords;  // id -> (x, y), empty -> none
+
+  Vertices V;  // without nullptr, empty unless explicit
+  Vertices U;  // with nullptr, i.e., |U| = width * height, ditto
   int width;   // grid width
   int height;  // grid height
   Graph();
-  Graph(const std::string& filename);  // taking map filename
+  // taking map filename, roadmap filename or binary graph filename
+  Graph(const std::string& filename, bool implicit = false);
   ~Graph();
+  Graph(const Graph&) = delete;  // vertices refer to the storage
+  Graph& operator=(const Graph&) = delete;
 
   int size() const;  // the number of vertices, |V|
+  uint64_t get_hash() const;  // hash of the contents, i.e., vertices and edges
+
+  inline Vertex* get_vertex(int id) const
+  {
+    if (storage == Storage::EXPLICIT) return V[id];
+    auto block = blocks[id >> BLOCK_BITS].load(std::memory_order_acquire);
+    if (block == nullptr) block = create_block(id >> BLOCK_BITS);
+    return block + (id & (BLOCK_SIZE - 1));
+  }
+  Vertex* get_vertex_by_index(int index) const;  // nullptr -> obstacle
+  int get_id(int index) const;                   // -1 -> obstacle
+  int get_index(int id) const;
+  template <typename F>
+  void for_each_neighbor(int id, F f) const;  // f(neighbor id)
+  int get_x(int index) const;  // position for logs
+  int get_y(int index) const;
+
+  // compact binary format, mapped as is by Graph(filename)
+  bool save_binary(const std::string& filename) const;
+
+  size_t num_created_blocks() const;  // for lazy storage
+  size_t get_memory_usage() const;    // bytes, approximate, except mappings
+
+private:
+  std::vector<uint32_t> owned_adj_offsets;
+  std::vector<uint32_t> owned_adj;
+  std::unique_ptr<MappedFile> mapping;
+
+  // vertices created on demand, thread-safe
+  struct VertexBlock {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> adj;  // only for implicit storage
+  };
+  mutable std::unique_ptr<std::atomic<Vertex*>[]> blocks;
+  mutable std::vector<std::unique_ptr<VertexBlock>> block_storage;
+  mutable std::mutex block_mutex;
+  Vertex* create_block(int b) const;
+
+  void clear();
+  // assuming empty V, cells are indexes of free cells
+  void init_vertices(const std::vector<int>& cells);
+  void init_grid_edges();  // 4-connected, from U
+  void link_neighbors();   // set views for all vertices, from CSR arrays
+  void init_implicit();    // from free_bits
+  void init_blocks();      // for lazy storage
+  void init_max_degree();  // from CSR arrays
+  bool load_binary(const std::string& filename);
+  bool load_roadmap(const std::string& filename, const MappedFile& file);
+  int find_id(int index) const;  // binary search on indexes
+};
+
+inline Vertex* Neighbors::iterator::operator*() const
+{
+  return G->get_vertex(*p);
+}
+inline Vertex* Neighbors::operator[](size_t k) const
+{
+  return G->get_vertex(first[k]);
+}
+
+inline int Graph::get_id(int index) const
+{
+  if (index < 0 || index >= width * height) return -1;
+  if (storage == Storage::EXPLICIT) {
+    return U[index] == nullptr ? -1 : U[index]->id;
+  }
+  if (storage == Storage::MAPPED) return find_id(index);
+  const auto word = free_bits[index >> 6];
+  const auto bit = index & 63;
+  if (!((word >> bit) & 1)) return -1;
+  return free_rank[index >> 6] +
+         __builtin_popcountll(word & ((uint64_t(1) << bit) - 1));
+}
+
+template <typename F>
+void Graph::for_each_neighbor(int id, F f) const
+{
+  if (storage != Storage::IMPLICIT) {
+    for (auto k = adj_offsets[id]; k < adj_offsets[id + 1]; ++k) f(adj[k]);
+    return;
+  }
+  const auto index = get_index(id);
+  const auto x = index % width;
+  const auto y = index / width;
+  auto add = [&](int u_index) {
+    const auto u = get_id(u_index);
+    if (u >= 0) f(u);
+  };
+  // same order as the explicit one
+  if (x > 0) add(index - 1);               // left
+  if (x < width - 1) add(index + 1);       // right
+  if (y < height - 1) add(index + width);  // up
+  if (y > 0) add(index - width);           // down
+}
+
+// configuration stored as a full snapshot or as a diff to its base
+struct PackedConfig {
+  std::unique_ptr<uint8_t[]> data;
+  const PackedConfig* base;  // nullptr -> data is a full snapshot
+  int num_diffs;             // number of changed agents, for diffs
+  int depth;                 // number of diffs to the nearest snapshot
+};
+
+// compact encoding of configurations, e.g., for the explored list
+// vertex ids and goal indices are packed into one buffer with narrow widths
+struct ConfigLayout {
+  const Graph* G;               // id -> vertex
+  const size_t N;               // number of agents
+  const int agent_width;        // bytes per agent id, 1, 2 or 4
+  const int v_width;            // bytes per vertex id, 1, 2 or 4
+  const int goal_width;         // bytes per goal index, 1, 2 or 4
+  const int snapshot_interval;  // max length of a chain of diffs
+
+  ConfigLayout(const Graph& _G, size_t _N, int max_goal_index,
+               int _snapshot_interval = 16);
+
+  // full snapshots
+  size_t bytes() const;  // buffer size per configuration
+  void encode(const Config& C, uint8_t* buf) const;
+  void decode(const uint8_t* buf, Config& C) const;
+  Vertex* get_vertex(const uint8_t* buf, size_t i) const;
+  int get_goal_index(const uint8_t* buf, size_t i) const;
+  bool equals(const uint8_t* buf, const Config& C) const;
+
+  // snapshots or diffs, C_base is the unpacked configuration of base
+  PackedConfig pack(const Config& C, const PackedConfig* base = nullptr,
+                    const Config* C_base = nullptr) const;
+  // C must hold the configuration of known, if given
+  void unpack(const PackedConfig& P, Config& C,
+              const PackedConfig* known = nullptr) const;
+  bool equals(const PackedConfig& P, const Config& C, Config& buf) const;
+  size_t bytes(const PackedConfig& P) const;
 };
 
-// hash function of configuration
-// c.f.
-// https://stackoverflow.com/questions/10405030/c-unordered-map-fail-when-used-with-a-vector-as-key
+// Zobrist hashing of configuration
+// keys of (agent, vertex) and (agent, goal_index) are generated on the fly
 struct ConfigHasher {
-  uint operator()(const Config& C) const;
+  uint64_t operator()(const Config& C) const;
+  // incremental version, only agents differing from C_prev are rehashed
+  uint64_t operator()(const Config& C, const Config& C_prev,
+                      uint64_t hash_prev) const;
+  // O(|moved| + |advanced|), agents with a new vertex or goal index
+  uint64_t operator()(const Config& C, const Config& C_prev,
+                      uint64_t hash_prev, const std::vector<int>& moved,
+                      const std::vector<int>& advanced) const;
 };
 
 std::ostream& operator<<(std::ostream& os, const Vertex* v);
@@ -24,20 +24,24 @@ struct Instance {
            const std::vector<std::vector<int>>& goal_index_sequences);
   // for MAPF benchmark
   Instance(const std::string& scen_filename, const std::string& map_filename,
-           const int _N = 1);
+           const int _N = 1, bool implicit_graph = false);
   // random instance generation
-  Instance(const std::string& map_filename, std::mt19937* MT, const int _N = 1);
+  Instance(const std::string& map_filename, std::mt19937* MT, const int _N = 1,
+           bool implicit_graph = false);
   ~Instance() {}
 
   // simple feasibility check of instance
   bool is_valid(const int verbose = 0) const;
 
   int get_total_goals() const;
+  int get_max_goal_index() const;  // goal indices are in [0, |sequence|]
 
   bool is_goal_config(const Config& C) const;
 
-  std::vector<int> calculate_goal_indices(const Config& c,
-                                          const Config& c_prev) const;
+  // advanced: if given, agents whose goal index advanced are appended
+  std::vector<int> calculate_goal_indices(
+      const Config& c, const Config& c_prev,
+      std::vector<int>* advanced = nullptr) const;
 };
 
 // solution: a sequence of configurations
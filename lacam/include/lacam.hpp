@@ -1,8 +1,12 @@
 #pragma once
 
+#include "closed_table.hpp"
+#include "dist_cache.hpp"
 #include "dist_table.hpp"
 #include "graph.hpp"
 #include "instance.hpp"
 #include "planner.hpp"
+#include "pool.hpp"
 #include "post_processing.hpp"
+#include "session.hpp"
 #include "utils.hpp"
@@ -3,36 +3,60 @@
  */
 #pragma once
 
+#include "closed_table.hpp"
 #include "dist_table.hpp"
 #include "graph.hpp"
 #include "instance.hpp"
+#include "pool.hpp"
 #include "utils.hpp"
+#include <atomic>
 #include <optional>
 
-// low-level search node
+// low-level search node, constraints are shared with ancestors via parent
 struct Constraint {
-  std::vector<int> who;
-  Vertices where;
-  const int depth;
+  Constraint* const parent;
+  const int who;        // agent
+  Vertex* const where;  // next location of the agent
+  const int depth;      // number of constraints in the chain
   Constraint();
-  Constraint(Constraint* parent, int i, Vertex* v);  // who and where
-  ~Constraint();
+  Constraint(Constraint* _parent, int i, Vertex* v);  // who and where
 };
+using Constraints = Pool<Constraint>;
 
 // high-level search node
 struct Node {
-  const Config C;
+  const PackedConfig C;  // snapshot or diff to the parent, c.f., ConfigLayout
+  const uint64_t hash;   // hash of C
   Node* parent;
 
-  // for low-level search
+  // for low-level search, priorities are stored every snapshot_interval
+  // steps, otherwise empty and rebuilt, c.f., Planner::get_priorities
+  // they are released once the search tree is exhausted, c.f., release()
   std::vector<float> priorities;
-  std::vector<int> order;
+  int priorities_depth;  // steps from the last ancestor storing priorities
   std::queue<Constraint*> search_tree;
 
-  Node(Config _C, DistTableMultiGoal& D, Node* _parent = nullptr);
+  // for anytime refinement, c.f., Planner::anytime
+  int g;                                         // cost from the initial node
+  int h;                                         // lower bound of the rest
+  std::vector<std::pair<Node*, int>> neighbors;  // successors and edge costs
+
+  Node(const Config& _C, uint64_t _hash, const ConfigLayout& layout,
+       DistTableMultiGoal& D, Node* _parent = nullptr,
+       const Config* C_parent = nullptr,
+       const std::vector<float>* priorities_parent = nullptr);
   ~Node();
+
+  // priorities of C, priorities_parent: nullptr -> initial ones
+  static void set_priorities(const Config& C, DistTableMultiGoal& D,
+                             const std::vector<float>* priorities_parent,
+                             std::vector<float>& priorities);
+
+  void release();  // no more successors, i.e., search_tree is empty
+  size_t bytes(const ConfigLayout& layout) const;  // memory usage
 };
 using Nodes = std::vector<Node*>;
+using NodePool = Pool<Node>;
 
 // PIBT agent
 struct Agent {
@@ -43,31 +67,85 @@ struct Agent {
 };
 using Agents = std::vector<Agent*>;
 
+// shared state of workers in the parallel search, c.f., planner.cpp
+struct ParallelSearch;
+
 // next location candidates, for saving memory allocation
-using Candidates = std::vector<std::array<Vertex*, 5> >;
+// one buffer per agent, of size max degree + 1
+using Candidates = std::vector<Vertices>;
 
 struct Planner {
   const Instance* ins;
   const Deadline* deadline;
   std::mt19937* MT;
   const int verbose;
-  const std::optional<int> threshold;
+  std::optional<int> threshold;  // may change between searches
   const bool allow_following;
+  const std::atomic<bool>* cancel;  // stop search if true, nullptr -> unused
+  int num_workers;                  // workers of the search, 1 -> sequential
+  bool anytime;                     // refine until the deadline, LaCAM*
 
   // solver utils
   const int N;  // number of agents
   const int V_size;
-  DistTableMultiGoal D;
+  const ConfigLayout layout;  // encoding of configurations in nodes
+  std::shared_ptr<DistTableMultiGoal> D;
   Candidates C_next;                // next location candidates
   std::vector<float> tie_breakers;  // random values, used in PIBT
   Agents A;
-  Agents occupied_now;   // for quick collision checking
-  Agents occupied_next;  // for quick collision checking
+  Agents occupied_now;         // for quick collision checking
+  Agents occupied_next;        // for quick collision checking
+  Config C_now;                // decoded configuration of the current node
+  Node* S_now;                 // node decoded to C_now
+  std::vector<int> order_now;  // agents sorted by priorities of S_order
+  Node* S_order;               // node sorted to order_now
+  std::vector<int> moved;      // agents changing vertices, for hashing
+  std::vector<int> advanced;   // agents advancing goal indices, ditto
+
+  // priorities of nodes not storing them, c.f., get_priorities
+  std::vector<float> priorities_now;  // priorities of S_priorities
+  Node* S_priorities;                 // node computed to priorities_now
+  std::vector<float> priorities_buf;  // buffers for rebuilding
+  Config C_buf;
+  Nodes nodes_buf;
+
+  // storage of search nodes, released in bulk after each search
+  // the capacities are kept for the next search, e.g., in sessions
+  NodePool NODES;
+  Constraints CONSTRAINTS;
+  ClosedTable CLOSED;  // for the sequential search
+
+  // trajectory tried first, e.g., the unexecuted rest of the previous plan
+  // nodes on it get constraints to its next configuration before others
+  Solution hint;
+  Node* hint_node;   // last created node on the hint
+  size_t hint_step;  // index of the next configuration of the hint
+
+  // improved solutions of the anytime mode, (elapsed ms, cost)
+  // cost follows get_edge_cost, i.e., get_sum_of_loss without threshold
+  // the anytime mode runs the sequential search, without deadline it stops
+  // only when OPEN is exhausted
+  std::vector<std::pair<double, int>> refinements;
 
   Planner(const Instance* _ins, const Deadline* _deadline, std::mt19937* _MT,
-          int _verbose = 0, const std::optional<int> threshold = std::nullopt, bool _allow_following = false);
+          int _verbose = 0, const std::optional<int> threshold = std::nullopt,
+          bool _allow_following = false,
+          std::shared_ptr<DistTableMultiGoal> _D = nullptr);  // shared table
   Solution solve();
-  bool get_new_config(Node* S, Constraint* M);
+  Solution solve_parallel();
+  void search_worker(ParallelSearch& P);
+  Node* create_node(const Config& C, uint64_t hash, Node* parent = nullptr,
+                    const Config* C_parent = nullptr);
+  void setup_hint();  // align the hint with the starts
+  int get_edge_cost(const Config& C_from, const Config& C_to) const;
+  int get_h_value(const Config& C);
+  void rewire(Node* S_from, std::stack<Node*>& OPEN, Node* S_goal);
+  const Config& get_config(Node* S);           // decode with cache
+  const std::vector<float>& get_priorities(Node* S);  // rebuild with cache
+  const std::vector<int>& get_order(Node* S);  // sort agents with cache
+  bool get_new_config(Node* S, const Config& C, Constraint* M);
+  // configuration of v_next after get_new_config, hashed incrementally
+  Config get_next_config(const Config& C_S, uint64_t hash_S, uint64_t& hash);
   bool funcPIBT(Agent* ai, const std::vector<int>& goal_indices,
                 Agent* caller = nullptr);
 };
@@ -75,4 +153,24 @@ struct Planner {
 // main function
 Solution solve(const Instance& ins, const int verbose = 0,
                const Deadline* deadline = nullptr, std::mt19937* MT = nullptr,
-               const std::optional<int> threshold = std::nullopt, const bool allow_following = false);
+               const std::optional<int> threshold = std::nullopt, const bool allow_following = false,
+               const Precompute precompute = Precompute::NONE,
+               const int num_threads = 0,
+               const std::string& dist_cache_dir = "",
+               const bool compress_dist_table = false,
+               std::shared_ptr<DistTableMultiGoal> D = nullptr,
+               const int num_workers = 1, const bool anytime = false);
+
+// portfolio of planners on threads, the first solution cancels the others
+// members differ in seeds, odd ones prohibit following conflicts if allowed
+// they share one distance table in the concurrent mode
+Solution solve_portfolio(const Instance& ins, const int verbose = 0,
+                         const Deadline* deadline = nullptr,
+                         const int seed = 0, const int num_planners = 0,
+                         const std::optional<int> threshold = std::nullopt,
+                         const bool allow_following = false,
+                         const Precompute precompute = Precompute::NONE,
+                         const int num_threads = 0,
+                         const std::string& dist_cache_dir = "",
+                         const bool compress_dist_table = false,
+                         std::shared_ptr<DistTableMultiGoal> D = nullptr);
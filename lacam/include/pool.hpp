@@ -0,0 +1,68 @@
+/*
+ * object pool for search nodes, objects are released in bulk
+ */
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T, size_t BLOCK_SIZE = 1024>
+class Pool
+{
+public:
+  Pool() : blocks(), num(0) {}
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+  ~Pool()
+  {
+    clear();
+    for (auto b : blocks) alloc.deallocate(b, BLOCK_SIZE);
+  }
+
+  template <typename... Args>
+  T* create(Args&&... args)
+  {
+    if (num == blocks.size() * BLOCK_SIZE)
+      blocks.push_back(alloc.allocate(BLOCK_SIZE));
+    auto p = blocks[num / BLOCK_SIZE] + (num % BLOCK_SIZE);
+    new (p) T(std::forward<Args>(args)...);
+    ++num;
+    return p;
+  }
+
+  // destroy the most recently created object, e.g., one turned out unused
+  void destroy_last()
+  {
+    --num;
+    (blocks[num / BLOCK_SIZE] + (num % BLOCK_SIZE))->~T();
+  }
+
+  // destroy all objects, memory blocks are kept for the next use
+  void clear()
+  {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for (size_t k = 0; k < num; ++k) {
+        (blocks[k / BLOCK_SIZE] + (k % BLOCK_SIZE))->~T();
+      }
+    }
+    num = 0;
+  }
+
+  template <typename F>
+  void for_each(F f) const
+  {
+    for (size_t k = 0; k < num; ++k) {
+      f(*(blocks[k / BLOCK_SIZE] + (k % BLOCK_SIZE)));
+    }
+  }
+
+  size_t size() const { return num; }
+  size_t capacity() const { return blocks.size() * BLOCK_SIZE; }
+
+private:
+  std::allocator<T> alloc;
+  std::vector<T*> blocks;
+  size_t num;  // number of live objects
+};
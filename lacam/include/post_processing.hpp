@@ -7,19 +7,60 @@
 #include "utils.hpp"
 #include <optional>
 
+// O(N T) check with occupancy arrays, timesteps are split among threads
 bool is_feasible_solution(const Instance& ins, const Solution& solution,
                           const int verbose, const std::optional<int> threshold,
-                          const bool allow_following);
+                          const bool allow_following,
+                          int num_threads = 0);  // 0 -> all cores
 int get_makespan(const Solution& solution);
 int get_path_cost(const Solution& solution, int i);  // single-agent path cost
 int get_sum_of_costs(const Solution& solution);
 int get_sum_of_loss(const Solution& solution);
+// lower bounds to the first goals, retired ones are skipped
 int get_makespan_lower_bound(const Instance& ins, DistTableMultiGoal& D);
 int get_sum_of_costs_lower_bound(const Instance& ins, DistTableMultiGoal& D);
+// dist_table: e.g., the one used by the planner, nullptr -> newly created
 void print_stats(const int verbose, const Instance& ins,
-                 const Solution& solution, const double comp_time_ms);
+                 const Solution& solution, const double comp_time_ms,
+                 DistTableMultiGoal* dist_table = nullptr);
 void make_log(const Instance& ins, const Solution& solution,
               const std::string& output_name, const double comp_time_ms,
               const std::string& map_name, const int seed,
               const bool log_short = false,  // true -> paths not appear
-              const bool skip_post_processing = false);
+              const bool skip_post_processing = false,
+              DistTableMultiGoal* dist_table = nullptr);
+
+// binary solution file, for large solutions
+// - header, goals, then full configurations every keyframe_interval steps
+// - moves are 3-bit codes per agent and timestep: wait, left, right, up, down
+// - vertices are given as indexes, i.e., width * y + x
+bool save_solution(const std::string& filename, const Instance& ins,
+                   const Solution& solution, const double comp_time_ms = 0,
+                   const int seed = 0);
+
+// random access to configurations of binary solution files
+struct SolutionReader {
+  MappedFile file;
+  bool is_valid;
+  int N;  // number of agents
+  int T;  // number of configurations, 0 -> not solved
+  int width;
+  int height;
+  int keyframe_interval;
+  int seed;
+  double comp_time_ms;
+  const uint32_t* goals;      // indexes of goals
+  const uint32_t* keyframes;  // indexes of configurations, starts first
+  const uint8_t* moves;       // for timesteps 1, 2, ..., T - 1
+
+  SolutionReader(const std::string& filename);
+  // indexes at timestep t, in O(N * keyframe_interval)
+  bool get(int t, std::vector<uint32_t>& indexes) const;
+  Solution load(const Graph& G) const;  // empty if broken or not in G
+};
+
+// text log in the format of make_log from a binary solution file, e.g., for
+// the visualizer, solution quality is not recorded
+bool make_log_from_binary(const std::string& solution_filename,
+                          const Graph& G, const std::string& output_name,
+                          const std::string& map_name);
@@ -0,0 +1,33 @@
+/*
+ * planning session for iterative use, e.g., lifelong MAPF with thresholds
+ * the graph, distance tables, planner buffers and node pools persist between
+ * rounds; each round takes the current configuration and appended goals
+ */
+#pragma once
+
+#include "planner.hpp"
+
+struct Session {
+  Instance* const ins;  // modified in place, starts and goals
+  const int verbose;
+  std::mt19937* MT;
+  const bool allow_following;
+  std::shared_ptr<DistTableMultiGoal> D;
+  std::unique_ptr<Planner> planner;
+  int num_rounds;
+
+  Session(Instance* _ins, int _verbose = 0, std::mt19937* _MT = nullptr,
+          bool _allow_following = false);
+
+  // append goals to the sequence of agent i
+  void append_goals(int i, const std::vector<Vertex*>& goals);
+
+  // plan until num_goals more goals are reached, nullopt -> all of them
+  // goal indices of C are taken as is, e.g., the last configuration of the
+  // previous round
+  // hint is followed first if possible, e.g., the unexecuted rest of the
+  // previous plan, c.f., Planner::hint
+  Solution solve(const Config& C, const std::optional<int> num_goals,
+                 const Deadline* deadline = nullptr,
+                 const Solution& hint = Solution());
+};
@@ -6,15 +6,18 @@
 #include <array>
 #include <chrono>
 #include <climits>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <numeric>
 #include <queue>
 #include <random>
 #include <regex>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -59,4 +62,29 @@ std::ostream& operator<<(std::ostream& os, std::vector<T> vec)
   return os;
 }
 
-uint hash_two_ints(uint a, uint b);
+uint64_t mix_hash(uint64_t x);  // splitmix64 finalizer
+
+// read-only memory mapping of a whole file
+struct MappedFile {
+  const char* data;
+  size_t size;
+  bool is_open;
+
+  MappedFile(const std::string& filename);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+};
+
+// line-by-line reader over a buffer, without copying, CRLF is supported
+struct LineReader {
+  const char* p;
+  const char* const end;
+  int line_number;  // of the last line read, starting from 1
+
+  LineReader(const char* data, size_t size);
+  bool next(std::string_view& line);
+};
+
+// strict parsing of a non-negative integer, the whole field must be digits
+bool parse_uint(std::string_view s, int& x);
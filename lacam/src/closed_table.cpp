@@ -0,0 +1,100 @@
+#include "../include/closed_table.hpp"
+
+#include "../include/planner.hpp"
+
+static constexpr double MAX_LOAD_FACTOR = 0.5;
+
+ClosedTable::ClosedTable(const ConfigLayout* _layout, size_t initial_capacity)
+    : layout(_layout),
+      C_buf(),
+      slots(),
+      num(0),
+      num_lookups(0),
+      num_probes(0),
+      max_probe_length(0)
+{
+  size_t capacity = 1;
+  while (capacity < initial_capacity) capacity <<= 1;
+  slots.assign(capacity, Slot{0, nullptr});
+}
+
+Node* ClosedTable::find(const Config& C, uint64_t hash)
+{
+  const auto mask = slots.size() - 1;
+  size_t probe_length = 1;
+  for (auto k = hash & mask;; k = (k + 1) & mask, ++probe_length) {
+    const auto& slot = slots[k];
+    if (slot.node == nullptr ||
+        (slot.hash == hash && layout->equals(slot.node->C, C, C_buf))) {
+      num_lookups += 1;
+      num_probes += probe_length;
+      max_probe_length = std::max(max_probe_length, probe_length);
+      return slot.node;
+    }
+  }
+}
+
+void ClosedTable::insert(Node* S, uint64_t hash)
+{
+  if (num + 1 > slots.size() * MAX_LOAD_FACTOR) grow();
+  const auto mask = slots.size() - 1;
+  auto k = hash & mask;
+  while (slots[k].node != nullptr) k = (k + 1) & mask;
+  slots[k] = Slot{hash, S};
+  num += 1;
+}
+
+void ClosedTable::grow()
+{
+  auto old_slots = std::vector<Slot>(slots.size() * 2, Slot{0, nullptr});
+  std::swap(slots, old_slots);
+  const auto mask = slots.size() - 1;
+  for (auto& slot : old_slots) {
+    if (slot.node == nullptr) continue;
+    auto k = slot.hash & mask;
+    while (slots[k].node != nullptr) k = (k + 1) & mask;
+    slots[k] = slot;
+  }
+}
+
+void ClosedTable::clear()
+{
+  std::fill(slots.begin(), slots.end(), Slot{0, nullptr});
+  num = 0;
+  num_lookups = 0;
+  num_probes = 0;
+  max_probe_length = 0;
+}
+
+double ClosedTable::load_factor() const
+{
+  return (double)num / slots.size();
+}
+
+double ClosedTable::average_probe_length() const
+{
+  if (num_lookups == 0) return 0;
+  return (double)num_probes / num_lookups;
+}
+
+ConcurrentClosedTable::ConcurrentClosedTable(const ConfigLayout* _layout,
+                                             size_t initial_capacity)
+    : shards()
+{
+  const size_t capacity = std::max(initial_capacity >> SHARD_BITS, size_t(1));
+  for (int k = 0; k < (1 << SHARD_BITS); ++k) {
+    shards.push_back(std::make_unique<Shard>(_layout, capacity));
+  }
+}
+
+void ConcurrentClosedTable::clear()
+{
+  for (auto& shard : shards) shard->table.clear();
+}
+
+size_t ConcurrentClosedTable::size() const
+{
+  size_t num = 0;
+  for (auto& shard : shards) num += shard->table.size();
+  return num;
+}
@@ -0,0 +1,96 @@
+#include "../include/dist_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+
+static constexpr char MAGIC[8] = {'L', 'A', 'C', 'A', 'M', 'D', 'T', '\0'};
+static constexpr uint32_t VERSION = 3;
+
+DistCache::DistCache(const std::string& _dir, const Graph& G)
+    : dir(_dir), graph_hash(G.get_hash()), K(G.size()), mappings()
+{
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+}
+
+DistCache::~DistCache()
+{
+  for (auto& [addr, len] : mappings) munmap(addr, len);
+}
+
+std::string DistCache::get_filename(int goal_id) const
+{
+  std::stringstream ss;
+  ss << dir << "/" << std::hex << graph_hash << std::dec << "-" << goal_id
+     << ".dist";
+  return ss.str();
+}
+
+const uint8_t* DistCache::load(int goal_id, int width)
+{
+  const auto filename = get_filename(goal_id);
+  const auto len = sizeof(Header) + (size_t)width * K;
+  auto fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size != len) {
+    close(fd);
+    return nullptr;
+  }
+  auto addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return nullptr;
+
+  // validate header
+  const auto header = static_cast<const Header*>(addr);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header->version != VERSION || header->K != (uint32_t)K ||
+      header->graph_hash != graph_hash ||
+      header->goal_id != (uint32_t)goal_id ||
+      header->width != (uint32_t)width) {
+    munmap(addr, len);
+    return nullptr;
+  }
+  mappings.emplace_back(addr, len);
+  return static_cast<const uint8_t*>(addr) + sizeof(Header);
+}
+
+void DistCache::adopt(DistCache& other)
+{
+  mappings.insert(mappings.end(), other.mappings.begin(),
+                  other.mappings.end());
+  other.mappings.clear();
+}
+
+bool DistCache::store(int goal_id, const uint8_t* dists, int width) const
+{
+  Header header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.K = K;
+  header.graph_hash = graph_hash;
+  header.goal_id = goal_id;
+  header.width = width;
+
+  // write to a temporary file, then rename for atomic replacement
+  const auto filename = get_filename(goal_id);
+  std::stringstream tmp_filename;
+  tmp_filename << filename << ".tmp." << getpid() << "."
+               << std::hash<std::thread::id>()(std::this_thread::get_id());
+  std::ofstream file(tmp_filename.str(), std::ios::binary);
+  if (!file) return false;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  file.write(reinterpret_cast<const char*>(dists), (size_t)width * K);
+  file.close();
+  if (!file) return false;
+  std::error_code ec;
+  std::filesystem::rename(tmp_filename.str(), filename, ec);
+  return !ec;
+}
@@ -1,60 +1,330 @@
 #include "../include/dist_table.hpp"
 
 #include <algorithm>
-
+#include <atomic>
+#include <cstring>
+#include <thread>
 
 DistTableMultiGoal::DistTableMultiGoal(const Instance* ins)
-    : K(ins->G.V.size()), table(), OPEN()
+    : G(&ins->G),
+      K(ins->G.size()),
+      width(get_width(ins->G)),
+      compress_finished(false),
+      concurrent(false),
+      table(),
+      dists(),
+      storage(),
+      OPEN(),
+      goals(),
+      table_ids(),
+      goal_table_ids(K, -1),
+      num_refs(),
+      free_ids(),
+      cache(nullptr),
+      locks()
 {
   setup(ins);
 }
 
-void DistTableMultiGoal::setup(const Instance* ins)
+int DistTableMultiGoal::get_width(const Graph& G)
 {
-  // initialize all values to K
-  for (size_t i = 0; i < ins->N; i++) {
-    table.push_back(std::vector<std::vector<int>>(ins->goal_sequences[i].size(),
-                                                  std::vector<int>(K, K)));
+  // distances are below K, UINT16_MAX is reserved for unreached vertices
+  const int K = G.size();
+  if (K <= UINT16_MAX) return 2;
+
+  // otherwise bounded by twice the eccentricity of one vertex in its
+  // component, and by the number of the other vertices elsewhere
+  auto d = std::vector<uint32_t>(K, UINT32_MAX);
+  auto open = std::queue<uint32_t>();
+  d[0] = 0;
+  open.push(0);
+  int eccentricity = 0;
+  int num_reached = 1;
+  while (!open.empty()) {
+    const auto n = open.front();
+    open.pop();
+    eccentricity = d[n];
+    G.for_each_neighbor(n, [&](uint32_t m) {
+      if (d[m] != UINT32_MAX) return;
+      d[m] = d[n] + 1;
+      num_reached += 1;
+      open.push(m);
+    });
   }
+  const auto bound = std::max(2 * eccentricity, K - num_reached - 1);
+  return bound < UINT16_MAX ? 2 : 4;
+}
 
-  // initialize search queues and table values for goals
+void DistTableMultiGoal::setup(const Instance* ins)
+{
+  // one table per distinct goal vertex, tables still in use are kept
+  auto prev_table_ids = std::move(table_ids);
+  table_ids = std::vector<std::vector<int>>(ins->N);
   for (size_t i = 0; i < ins->N; i++) {
-    OPEN.push_back(
-        std::vector<std::queue<Vertex*>>(ins->goal_sequences[i].size()));
-    for (size_t j = 0; j < ins->goal_sequences[i].size(); j++) {
-      auto g = ins->goal_sequences[i][j];
-      OPEN[i][j].push(g);
-      table[i][j][g->id] = 0;
+    for (auto g : ins->goal_sequences[i]) table_ids[i].push_back(acquire(g));
+  }
+  for (auto& ids : prev_table_ids) {
+    for (auto id : ids) {
+      if (id >= 0) release(id);
     }
   }
 }
 
-int DistTableMultiGoal::get(int agent_id, int goal_index, int from_id)
+int DistTableMultiGoal::get_table_id(Vertex* g)
+{
+  if (goal_table_ids[g->id] >= 0) return goal_table_ids[g->id];
+
+  // released slots are reused first
+  int id = table.size();
+  if (!free_ids.empty()) {
+    id = free_ids.back();
+    free_ids.pop_back();
+  } else {
+    table.emplace_back();
+    dists.push_back(nullptr);
+    storage.push_back(Storage::U16);
+    OPEN.emplace_back();
+    goals.push_back(nullptr);
+    num_refs.push_back(0);
+    locks.push_back(std::make_unique<std::mutex>());
+  }
+  goal_table_ids[g->id] = id;
+
+  // initialize all values to unreached, search queue starts from the goal
+  table[id] = std::vector<uint8_t>(K * width);
+  if (width == 2) {
+    auto d = reinterpret_cast<uint16_t*>(table[id].data());
+    std::fill(d, d + K, UINT16_MAX);
+    d[g->id] = 0;
+    storage[id] = Storage::U16;
+  } else {
+    auto d = reinterpret_cast<uint32_t*>(table[id].data());
+    std::fill(d, d + K, UINT32_MAX);
+    d[g->id] = 0;
+    storage[id] = Storage::U32;
+  }
+  dists[id] = table[id].data();
+  goals[id] = g;
+  OPEN[id].push(g->id);
+  if (cache != nullptr) load_cache(id);
+  return id;
+}
+
+int DistTableMultiGoal::acquire(Vertex* g)
+{
+  const auto id = get_table_id(g);
+  num_refs[id] += 1;
+  return id;
+}
+
+void DistTableMultiGoal::release(int id)
+{
+  num_refs[id] -= 1;
+  if (num_refs[id] > 0) return;
+  goal_table_ids[goals[id]->id] = -1;
+  table[id] = std::vector<uint8_t>();
+  OPEN[id] = std::queue<uint32_t>();
+  dists[id] = nullptr;
+  goals[id] = nullptr;
+  free_ids.push_back(id);
+}
+
+void DistTableMultiGoal::append_goals(int agent_id,
+                                      const Vertices& goal_sequence)
+{
+  for (auto g : goal_sequence) table_ids[agent_id].push_back(acquire(g));
+}
+
+void DistTableMultiGoal::retire_goals(int agent_id, int goal_index)
+{
+  // retired entries are -1, goal indices of agents stay as they are
+  auto& ids = table_ids[agent_id];
+  goal_index = std::min(goal_index, (int)ids.size() - 1);
+  for (int k = 0; k < goal_index; ++k) {
+    if (ids[k] < 0) continue;
+    release(ids[k]);
+    ids[k] = -1;
+  }
+}
+
+void DistTableMultiGoal::use_cache(const std::string& dir, const Graph& G)
+{
+  // keep the current cache for the same dir and graph, e.g., repeated solve()
+  if (cache == nullptr || cache->dir != dir ||
+      cache->graph_hash != G.get_hash()) {
+    auto next = std::make_unique<DistCache>(dir, G);
+    if (cache != nullptr) next->adopt(*cache);
+    cache = std::move(next);
+  }
+  for (size_t id = 0; id < table.size(); ++id) {
+    if (goals[id] != nullptr) load_cache(id);
+  }
+}
+
+bool DistTableMultiGoal::load_cache(int id)
+{
+  // only for tables whose BFS has not started yet
+  const auto g = (uint32_t)goals[id]->id;
+  if (OPEN[id].size() != 1 || OPEN[id].front() != g) return false;
+  auto cached = cache->load(goals[id]->id, width);
+  if (cached == nullptr) return false;
+  dists[id] = cached;
+  table[id] = std::vector<uint8_t>();  // release memory
+  OPEN[id] = std::queue<uint32_t>();
+  if (compress_finished) compress(id);
+  return true;
+}
+
+int DistTableMultiGoal::find_table_id(int agent_id, int goal_index) const
 {
   // goal_index can be past the end to signify we've already reached the last
   // goal, but when we want to use the index we need to cap it at the last goal
-  goal_index = std::min(goal_index, (int)(table[agent_id].size() - 1));
+  const auto& ids = table_ids[agent_id];
+  goal_index = std::min(goal_index, (int)(ids.size() - 1));
+  // retired goals are skipped, the last one is always kept
+  while (ids[goal_index] < 0) ++goal_index;
+  return ids[goal_index];
+}
+
+int DistTableMultiGoal::get(int agent_id, int goal_index, int from_id)
+{
+  const auto id = find_table_id(agent_id, goal_index);
+
+  const auto d = read(id, from_id);
+  if (d < K) return d;
+  if (!concurrent) return resume_bfs(id, from_id);
 
-  if (table[agent_id][goal_index][from_id] < K)
-    return table[agent_id][goal_index][from_id];
+  std::lock_guard<std::mutex> lock(*locks[id]);
+  const auto d_locked = read(id, from_id);  // maybe filled by another thread
+  if (d_locked < K) return d_locked;
+  return resume_bfs(id, from_id);
+}
+
+template <typename T>
+static int bfs(const Graph* G, T* d, std::queue<uint32_t>& open, int from_id,
+               int K)
+{
+  while (!open.empty()) {
+    const int n = open.front();
+    open.pop();
+    const int d_n = d[n];
+    G->for_each_neighbor(n, [&](uint32_t m) {
+      if ((uint32_t)d_n + 1 >= (uint32_t)d[m]) return;  // unreached is max
+      __atomic_store_n(d + m, (T)(d_n + 1), __ATOMIC_RELAXED);  // for readers
+      open.push(m);
+    });
+    if (n == from_id) return d_n;
+  }
+  return K;
+}
 
+int DistTableMultiGoal::resume_bfs(int id, int from_id)
+{
   /*
    * BFS with lazy evaluation
    * c.f., Reverse Resumable A*
    * https://www.aaai.org/Papers/AIIDE/2005/AIIDE05-020.pdf
    */
 
-  while (!OPEN[agent_id][goal_index].empty()) {
-    auto n = OPEN[agent_id][goal_index].front();
-    OPEN[agent_id][goal_index].pop();
-    const int d_n = table[agent_id][goal_index][n->id];
-    for (auto& m : n->neighbor) {
-      const int d_m = table[agent_id][goal_index][m->id];
-      if (d_n + 1 >= d_m) continue;
-      table[agent_id][goal_index][m->id] = d_n + 1;
-      OPEN[agent_id][goal_index].push(m);
+  auto& open = OPEN[id];
+  if (open.empty()) return K;
+  const auto d_from =
+      storage[id] == Storage::U16
+          ? bfs(G, reinterpret_cast<uint16_t*>(table[id].data()), open,
+                from_id, K)
+          : bfs(G, reinterpret_cast<uint32_t*>(table[id].data()), open,
+                from_id, K);
+  if (open.empty()) finish(id);
+  return d_from;
+}
+
+void DistTableMultiGoal::finish(int id)
+{
+  // write back the complete table
+  if (cache != nullptr) cache->store(goals[id]->id, table[id].data(), width);
+  // readers may be in the plain table
+  if (compress_finished && !concurrent) compress(id);
+}
+
+bool DistTableMultiGoal::compress(int id)
+{
+  if (!OPEN[id].empty() || storage[id] == Storage::BLOCK) return false;
+
+  // base of each block, i.e., minimum of reachable vertices
+  const auto B = num_blocks();
+  auto bases = std::vector<uint32_t>(B, K);
+  for (int v_id = 0; v_id < K; ++v_id) {
+    auto& base = bases[v_id / BLOCK_SIZE];
+    base = std::min(base, (uint32_t)read(id, v_id));
+  }
+
+  // [bases][deltas], UINT8_MAX is reserved for unreachable vertices
+  auto buf = std::vector<uint8_t>(B * sizeof(uint32_t) + K);
+  std::memcpy(buf.data(), bases.data(), B * sizeof(uint32_t));
+  auto deltas = buf.data() + B * sizeof(uint32_t);
+  for (int v_id = 0; v_id < K; ++v_id) {
+    const auto d = read(id, v_id);
+    if (d >= K) {
+      deltas[v_id] = UINT8_MAX;
+      continue;
     }
-    if (n->id == from_id) return d_n;
+    const auto delta = d - bases[v_id / BLOCK_SIZE];
+    if (delta >= UINT8_MAX) return false;
+    deltas[v_id] = delta;
   }
-  return K;
+
+  table[id] = std::move(buf);
+  dists[id] = table[id].data();
+  storage[id] = Storage::BLOCK;
+  return true;
+}
+
+size_t DistTableMultiGoal::get_memory_usage() const
+{
+  size_t bytes = 0;
+  for (auto& t : table) bytes += t.capacity();
+  return bytes;
+}
+
+double DistTableMultiGoal::precompute(Precompute policy, int num_threads)
+{
+  const auto t_s = Time::now();
+
+  // tables to be filled
+  std::vector<int> ids;
+  if (policy == Precompute::ALL_GOALS) {
+    for (size_t id = 0; id < table.size(); ++id) {
+      if (goals[id] != nullptr) ids.push_back(id);
+    }
+  } else if (policy == Precompute::FIRST_GOALS) {
+    // first goals not retired yet
+    for (auto& ids_i : table_ids) {
+      auto itr = std::find_if(ids_i.begin(), ids_i.end(),
+                              [](int id) { return id >= 0; });
+      if (itr != ids_i.end()) ids.push_back(*itr);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  }
+
+  // each table is filled by exactly one thread
+  if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+  num_threads = std::max(1, std::min(num_threads, (int)ids.size()));
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (auto k = next++; k < ids.size(); k = next++) {
+      if (concurrent) {
+        std::lock_guard<std::mutex> lock(*locks[ids[k]]);
+        resume_bfs(ids[k]);
+      } else {
+        resume_bfs(ids[k]);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int k = 1; k < num_threads; ++k) threads.emplace_back(worker);
+  worker();
+  for (auto& th : threads) th.join();
+
+  return std::chrono::duration<double, std::milli>(Time::now() - t_s).count();
 }
@@ -1,110 +1,788 @@
 #include "../include/graph.hpp"
 
-Vertex::Vertex(int _id, int _index)
-    : id(_id), index(_index), neighbor(Vertices())
+#include <algorithm>
+#include <cstring>
+
+Vertex::Vertex(int _id, int _index) : id(_id), index(_index), neighbor() {}
+
+Graph::Graph()
+    : storage(Storage::EXPLICIT),
+      num_vertices(0),
+      max_degree(0),
+      adj_offsets(nullptr),
+      adj(nullptr),
+      vertices(),
+      free_bits(),
+      free_rank(),
+      block_head(),
+      indexes(nullptr),
+      coords(),
+      V(Vertices()),
+      width(0),
+      height(0),
+      owned_adj_offsets(),
+      owned_adj(),
+      mapping(nullptr),
+      blocks(nullptr),
+      block_storage()
 {
 }
+Graph::~Graph() {}
 
-Graph::Graph() : V(Vertices()), width(0), height(0) {}
-Graph::~Graph()
+void Graph::clear()
 {
-  for (auto& v : V)
-    if (v != nullptr) delete v;
+  num_vertices = 0;
+  max_degree = 0;
+  adj_offsets = nullptr;
+  adj = nullptr;
+  vertices.clear();
+  free_bits.clear();
+  free_rank.clear();
+  block_head.clear();
+  indexes = nullptr;
+  coords.clear();
   V.clear();
+  U.clear();
+  width = 0;
+  height = 0;
+  owned_adj_offsets.clear();
+  owned_adj.clear();
+  mapping.reset();
+  blocks.reset();
+  block_storage.clear();
 }
 
-// to load graph
-static const std::regex r_height = std::regex(R"(height\s(\d+))");
-static const std::regex r_width = std::regex(R"(width\s(\d+))");
-static const std::regex r_map = std::regex(R"(map)");
+void Graph::init_vertices(const std::vector<int>& cells)
+{
+  vertices.reserve(cells.size());  // no reallocation, V refers to them
+  for (auto index : cells) {
+    vertices.emplace_back(vertices.size(), index);
+    V.push_back(&vertices.back());
+    if (index < (int)U.size()) U[index] = &vertices.back();
+  }
+  num_vertices = V.size();
+}
 
-Graph::Graph(const std::string& filename) : V(Vertices()), width(0), height(0)
+void Graph::init_grid_edges()
 {
-  std::ifstream file(filename);
-  if (!file) {
-    std::cout << "file " << filename << " is not found." << std::endl;
-    return;
+  owned_adj_offsets.assign(1, 0);
+  owned_adj.clear();
+  owned_adj.reserve(V.size() * 4);
+  auto add = [&](int x, int y) {
+    auto u = U[width * y + x];
+    if (u != nullptr) owned_adj.push_back(u->id);
+  };
+  for (auto v : V) {
+    const auto x = v->index % width;
+    const auto y = v->index / width;
+    if (x > 0) add(x - 1, y);           // left
+    if (x < width - 1) add(x + 1, y);   // right
+    if (y < height - 1) add(x, y + 1);  // up
+    if (y > 0) add(x, y - 1);           // down
+    owned_adj_offsets.push_back(owned_adj.size());
   }
-  std::string line;
-  std::smatch results;
+  adj_offsets = owned_adj_offsets.data();
+  adj = owned_adj.data();
+  init_max_degree();
+  link_neighbors();
+}
 
-  // read fundamental graph parameters
-  while (getline(file, line)) {
-    // for CRLF coding
-    if (*(line.end() - 1) == 0x0d) line.pop_back();
+void Graph::init_max_degree()
+{
+  max_degree = 0;
+  for (int id = 0; id < num_vertices; ++id) {
+    max_degree =
+        std::max(max_degree, (int)(adj_offsets[id + 1] - adj_offsets[id]));
+  }
+}
 
-    if (std::regex_match(line, results, r_height)) {
-      height = std::stoi(results[1].str());
+void Graph::link_neighbors()
+{
+  for (auto& v : vertices) {
+    v.neighbor = Neighbors(adj + adj_offsets[v.id], adj + adj_offsets[v.id + 1],
+                           this);
+  }
+}
+
+void Graph::init_implicit()
+{
+  storage = Storage::IMPLICIT;
+
+  // rank index
+  free_rank.assign(free_bits.size() + 1, 0);
+  for (size_t w = 0; w < free_bits.size(); ++w) {
+    free_rank[w + 1] = free_rank[w] + __builtin_popcountll(free_bits[w]);
+  }
+  num_vertices = free_rank.back();
+  max_degree = 4;
+
+  // cell index of the first vertex of each block, for select
+  block_head.clear();
+  uint32_t id = 0;
+  for (size_t w = 0; w < free_bits.size(); ++w) {
+    for (auto word = free_bits[w]; word != 0; word &= word - 1, ++id) {
+      if (id % BLOCK_SIZE == 0) {
+        block_head.push_back(w * 64 + __builtin_ctzll(word));
+      }
     }
-    if (std::regex_match(line, results, r_width)) {
-      width = std::stoi(results[1].str());
+  }
+  init_blocks();
+}
+
+void Graph::init_blocks()
+{
+  const auto num_blocks = (num_vertices + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  blocks = std::make_unique<std::atomic<Vertex*>[]>(num_blocks);
+  for (int b = 0; b < num_blocks; ++b) blocks[b].store(nullptr);
+  block_storage.resize(num_blocks);
+}
+
+int Graph::get_index(int id) const
+{
+  if (storage == Storage::EXPLICIT) return V[id]->index;
+  if (storage == Storage::MAPPED) return indexes[id];
+  // find the word, starting from the head of the block
+  auto w = block_head[id >> BLOCK_BITS] >> 6;
+  while (free_rank[w + 1] <= (uint32_t)id) ++w;
+  // select within the word, by halving
+  auto word = free_bits[w];
+  int r = id - free_rank[w];
+  int pos = 0;
+  for (int half = 32; half > 0; half >>= 1) {
+    const int c = __builtin_popcountll(word & ((uint64_t(1) << half) - 1));
+    if (r >= c) {
+      r -= c;
+      word >>= half;
+      pos += half;
     }
-    if (std::regex_match(line, results, r_map)) break;
   }
+  return w * 64 + pos;
+}
 
-  U = Vertices(width * height, nullptr);
+int Graph::find_id(int index) const
+{
+  auto p = std::lower_bound(indexes, indexes + num_vertices, (uint32_t)index);
+  if (p == indexes + num_vertices || *p != (uint32_t)index) return -1;
+  return p - indexes;
+}
 
-  // create vertices
-  int y = 0;
-  while (getline(file, line)) {
-    // for CRLF coding
-    if (*(line.end() - 1) == 0x0d) line.pop_back();
-    for (int x = 0; x < width; ++x) {
-      char s = line[x];
-      if (s == 'T' or s == '@') continue;  // object
-      auto index = width * y + x;
-      auto v = new Vertex(V.size(), index);
-      V.push_back(v);
-      U[index] = v;
+Vertex* Graph::get_vertex_by_index(int index) const
+{
+  const auto id = get_id(index);
+  return id < 0 ? nullptr : get_vertex(id);
+}
+
+Vertex* Graph::create_block(int b) const
+{
+  std::lock_guard<std::mutex> lock(block_mutex);
+  auto block = blocks[b].load(std::memory_order_relaxed);
+  if (block != nullptr) return block;  // created by another thread
+
+  auto new_block = std::make_unique<VertexBlock>();
+  const int id_s = b * BLOCK_SIZE;
+  const int id_e = std::min(id_s + BLOCK_SIZE, num_vertices);
+  new_block->vertices.reserve(id_e - id_s);
+  for (auto id = id_s; id < id_e; ++id) {
+    new_block->vertices.emplace_back(id, get_index(id));
+  }
+  if (adj != nullptr) {
+    // views to the mapped arrays
+    for (auto& v : new_block->vertices) {
+      v.neighbor = Neighbors(adj + adj_offsets[v.id],
+                             adj + adj_offsets[v.id + 1], this);
+    }
+  } else {
+    // computed neighbors
+    auto offsets = std::vector<uint32_t>(1, 0);
+    new_block->adj.reserve((id_e - id_s) * 4);
+    for (auto id = id_s; id < id_e; ++id) {
+      for_each_neighbor(id, [&](int u) { new_block->adj.push_back(u); });
+      offsets.push_back(new_block->adj.size());
+    }
+    for (auto& v : new_block->vertices) {
+      const auto k = v.id - id_s;
+      v.neighbor = Neighbors(new_block->adj.data() + offsets[k],
+                             new_block->adj.data() + offsets[k + 1], this);
     }
-    ++y;
   }
+
+  block = new_block->vertices.data();
+  block_storage[b] = std::move(new_block);
+  blocks[b].store(block, std::memory_order_release);
+  return block;
+}
+
+size_t Graph::num_created_blocks() const
+{
+  std::lock_guard<std::mutex> lock(block_mutex);
+  return std::count_if(block_storage.begin(), block_storage.end(),
+                       [](auto& b) { return b != nullptr; });
+}
+
+size_t Graph::get_memory_usage() const
+{
+  auto usage = vertices.capacity() * sizeof(Vertex) +
+               (owned_adj_offsets.capacity() + owned_adj.capacity()) *
+                   sizeof(uint32_t) +
+               (V.capacity() + U.capacity()) * sizeof(Vertex*) +
+               free_bits.capacity() * sizeof(uint64_t) +
+               (free_rank.capacity() + block_head.capacity()) *
+                   sizeof(uint32_t) +
+               block_storage.capacity() *
+                   (sizeof(std::atomic<Vertex*>) + sizeof(void*));
+  std::lock_guard<std::mutex> lock(block_mutex);
+  for (auto& b : block_storage) {
+    if (b == nullptr) continue;
+    usage += b->vertices.capacity() * sizeof(Vertex) +
+             b->adj.capacity() * sizeof(uint32_t);
+  }
+  return usage;
+}
+
+// binary graph file
+// header + indexes[K] + adj_offsets[K + 1] + adj[E], all uint32
+struct BinaryGraphHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t K;  // number of vertices
+  uint32_t E;  // number of adjacency entries, i.e., twice the edges
+  uint32_t reserved;
+  uint64_t graph_hash;  // c.f., Graph::get_hash
+  uint64_t checksum;    // of the contents after the header
+};
+static constexpr char BINARY_MAGIC[8] = {'L', 'A', 'C', 'A',
+                                         'M', 'G', 'R', '\0'};
+static constexpr uint32_t BINARY_VERSION = 1;
+
+static uint64_t get_checksum(const uint8_t* data, size_t size)
+{
+  // four independent lanes of 64-bit words, then the tail
+  uint64_t lanes[4] = {1, 2, 3, 4};
+  size_t k = 0;
+  for (; k + 32 <= size; k += 32) {
+    for (int j = 0; j < 4; ++j) {
+      uint64_t x;
+      std::memcpy(&x, data + k + j * 8, 8);
+      lanes[j] = mix_hash(lanes[j] ^ x);
+    }
+  }
+  uint64_t hash = mix_hash(size);
+  for (auto lane : lanes) hash = mix_hash(hash ^ lane);
+  for (; k < size; ++k) hash = mix_hash(hash ^ data[k]);
+  return hash;
+}
+
+bool Graph::save_binary(const std::string& filename) const
+{
+  const auto K = size();
+  std::vector<uint32_t> contents(K);
+  for (int id = 0; id < K; ++id) contents[id] = get_index(id);
+  contents.push_back(0);
+  for (int id = 0; id < K; ++id) {
+    uint32_t degree = 0;
+    for_each_neighbor(id, [&](int) { ++degree; });
+    contents.push_back(contents.back() + degree);
+  }
+  const auto E = contents.back();
+  for (int id = 0; id < K; ++id) {
+    for_each_neighbor(id, [&](int u) { contents.push_back(u); });
+  }
+
+  BinaryGraphHeader header;
+  std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  header.version = BINARY_VERSION;
+  header.width = width;
+  header.height = height;
+  header.K = K;
+  header.E = E;
+  header.reserved = 0;
+  header.graph_hash = get_hash();
+  header.checksum =
+      get_checksum(reinterpret_cast<const uint8_t*>(contents.data()),
+                   contents.size() * sizeof(uint32_t));
+
+  std::ofstream file(filename, std::ios::binary);
+  if (!file) return false;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(contents.data()),
+             contents.size() * sizeof(uint32_t));
   file.close();
+  return (bool)file;
+}
 
-  // create edges
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      auto v = U[width * y + x];
-      if (v == nullptr) continue;
-      // left
-      if (x > 0) {
-        auto u = U[width * y + (x - 1)];
-        if (u != nullptr) v->neighbor.push_back(u);
+bool Graph::load_binary(const std::string& filename)
+{
+  const auto header =
+      reinterpret_cast<const BinaryGraphHeader*>(mapping->data);
+  auto error = [&](const std::string& msg) {
+    std::cout << filename << ": " << msg << std::endl;
+    clear();
+    return false;
+  };
+  if (mapping->size < sizeof(BinaryGraphHeader)) {
+    return error("truncated binary graph");
+  }
+  if (header->version != BINARY_VERSION) {
+    return error("unsupported binary graph version");
+  }
+  const auto contents_size =
+      ((size_t)header->K * 2 + 1 + header->E) * sizeof(uint32_t);
+  if (mapping->size != sizeof(BinaryGraphHeader) + contents_size) {
+    return error("truncated binary graph");
+  }
+  const auto contents = reinterpret_cast<const uint32_t*>(
+      mapping->data + sizeof(BinaryGraphHeader));
+  if (get_checksum(reinterpret_cast<const uint8_t*>(contents),
+                   contents_size) != header->checksum) {
+    return error("checksum mismatch");
+  }
+
+  storage = Storage::MAPPED;
+  width = header->width;
+  height = header->height;
+  num_vertices = header->K;
+  indexes = contents;
+  adj_offsets = indexes + num_vertices;
+  adj = adj_offsets + num_vertices + 1;
+  init_max_degree();
+  init_blocks();
+  return true;
+}
+
+// whitespace-separated fields, returns the number of fields
+template <size_t N>
+static size_t split_fields(std::string_view line,
+                           std::array<std::string_view, N>& fields)
+{
+  size_t num = 0;
+  while (true) {
+    const auto s = line.find_first_not_of(" \t");
+    if (s == std::string_view::npos) return num;
+    if (num == N) return N + 1;  // too many
+    line.remove_prefix(s);
+    const auto e = std::min(line.find_first_of(" \t"), line.size());
+    fields[num++] = line.substr(0, e);
+    line.remove_prefix(e);
+  }
+}
+
+// type roadmap
+// vertices <number of vertices>
+// v <id> <x> <y>  (optional) coordinates for logs
+// e <id> <id>     undirected edge
+// lines starting with # are comments
+bool Graph::load_roadmap(const std::string& filename, const MappedFile& file)
+{
+  auto reader = LineReader(file.data, file.size);
+  std::string_view line;
+  auto error = [&](const std::string& msg) {
+    std::cout << filename << ":" << reader.line_number << ": " << msg
+              << std::endl;
+    clear();
+    return false;
+  };
+
+  int K = -1;
+  std::vector<std::vector<uint32_t>> neighbors;
+  std::array<std::string_view, 4> fields;
+  reader.next(line);  // type roadmap
+  while (reader.next(line)) {
+    const auto num_fields = split_fields(line, fields);
+    if (num_fields == 0 || fields[0][0] == '#') continue;
+    if (K < 0) {
+      if (num_fields != 2 || fields[0] != "vertices" ||
+          !parse_uint(fields[1], K) || K == 0) {
+        return error("\"vertices <number>\" is expected");
+      }
+      neighbors.resize(K);
+      continue;
+    }
+    int id, x, y, u, v;
+    if (fields[0] == "v" && num_fields == 4) {
+      if (!parse_uint(fields[1], id) || id >= K ||
+          !parse_uint(fields[2], x) || !parse_uint(fields[3], y)) {
+        return error("invalid vertex");
       }
-      // right
-      if (x < width - 1) {
-        auto u = U[width * y + (x + 1)];
-        if (u != nullptr) v->neighbor.push_back(u);
+      if (coords.empty()) {
+        for (int k = 0; k < K; ++k) coords.emplace_back(k, 0);
       }
-      // up
-      if (y < height - 1) {
-        auto u = U[width * (y + 1) + x];
-        if (u != nullptr) v->neighbor.push_back(u);
+      coords[id] = {x, y};
+    } else if (fields[0] == "e" && num_fields == 3) {
+      if (!parse_uint(fields[1], u) || u >= K || !parse_uint(fields[2], v) ||
+          v >= K || u == v) {
+        return error("invalid edge");
+      }
+      neighbors[u].push_back(v);
+      neighbors[v].push_back(u);
+    } else {
+      return error("unknown line");
+    }
+  }
+  if (K < 0) return error("\"vertices <number>\" is not found");
+
+  // vertices, indexes are ids
+  width = K;
+  height = 1;
+  U = Vertices(K, nullptr);
+  auto cells = std::vector<int>(K);
+  std::iota(cells.begin(), cells.end(), 0);
+  init_vertices(cells);
+
+  // edges, sorted by ids and without duplicates
+  owned_adj_offsets.assign(1, 0);
+  for (auto& ids : neighbors) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    owned_adj.insert(owned_adj.end(), ids.begin(), ids.end());
+    owned_adj_offsets.push_back(owned_adj.size());
+  }
+  adj_offsets = owned_adj_offsets.data();
+  adj = owned_adj.data();
+  init_max_degree();
+  link_neighbors();
+  return true;
+}
+
+// "<key> <value>" in the header of map files
+static bool parse_header_field(std::string_view line, std::string_view key,
+                               int& value)
+{
+  if (line.size() <= key.size() || line.substr(0, key.size()) != key) {
+    return false;
+  }
+  if (line[key.size()] != ' ' && line[key.size()] != '\t') return false;
+  return parse_uint(line.substr(key.size() + 1), value);
+}
+
+Graph::Graph(const std::string& filename, bool implicit) : Graph()
+{
+  auto file = std::make_unique<MappedFile>(filename);
+  if (!file->is_open) {
+    std::cout << "file " << filename << " is not found." << std::endl;
+    return;
+  }
+
+  // binary graph, the mapping is kept as storage
+  if (file->size >= sizeof(BINARY_MAGIC) &&
+      std::memcmp(file->data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+    mapping = std::move(file);
+    load_binary(filename);
+    return;
+  }
+
+  // roadmap
+  if (std::string_view(file->data, file->size).substr(0, 12) ==
+      "type roadmap") {
+    load_roadmap(filename, *file);
+    return;
+  }
+
+  // map file
+  auto reader = LineReader(file->data, file->size);
+  std::string_view line;
+  auto error = [&](const std::string& msg) {
+    std::cout << filename << ":" << reader.line_number << ": " << msg
+              << std::endl;
+    clear();
+  };
+
+  // read fundamental graph parameters
+  bool map_found = false;
+  while (reader.next(line)) {
+    if (parse_header_field(line, "height", height)) continue;
+    if (parse_header_field(line, "width", width)) continue;
+    if (line == "map") {
+      map_found = true;
+      break;
+    }
+  }
+  if (!map_found) {
+    error("\"map\" line is not found");
+    return;
+  }
+
+  // find free cells
+  std::vector<int> cells;
+  if (implicit) free_bits.assign(((size_t)width * height + 63) / 64, 0);
+  for (int y = 0; y < height; ++y) {
+    if (!reader.next(line)) {
+      error("too few rows in the map");
+      return;
+    }
+    if ((int)line.size() < width) {
+      error("too short row in the map");
+      return;
+    }
+    for (int x = 0; x < width; ++x) {
+      char s = line[x];
+      if (s == 'T' or s == '@') continue;  // object
+      const auto index = width * y + x;
+      if (implicit) {
+        free_bits[index >> 6] |= uint64_t(1) << (index & 63);
+      } else {
+        cells.push_back(index);
       }
-      // down
-      if (y > 0) {
-        auto u = U[width * (y - 1) + x];
-        if (u != nullptr) v->neighbor.push_back(u);
+    }
+  }
+
+  if (implicit) {
+    init_implicit();
+    return;
+  }
+  U = Vertices(width * height, nullptr);
+  init_vertices(cells);
+  init_grid_edges();
+}
+
+int Graph::size() const { return num_vertices; }
+
+int Graph::get_x(int index) const
+{
+  return coords.empty() ? index % width : coords[index].first;
+}
+
+int Graph::get_y(int index) const
+{
+  return coords.empty() ? index / width : coords[index].second;
+}
+
+uint64_t Graph::get_hash() const
+{
+  if (storage == Storage::MAPPED) {
+    return reinterpret_cast<const BinaryGraphHeader*>(mapping->data)
+        ->graph_hash;
+  }
+  uint64_t hash = mix_hash(((uint64_t)width << 32) | height);
+  const auto K = size();
+  for (int id = 0; id < K; ++id) {
+    hash = mix_hash(hash ^ get_index(id));
+    for_each_neighbor(id, [&](int u) { hash = mix_hash(hash ^ u); });
+  }
+  return hash;
+}
+
+static int get_width(uint64_t max_value)
+{
+  if (max_value <= UINT8_MAX) return 1;
+  if (max_value <= UINT16_MAX) return 2;
+  return 4;
+}
+
+static inline uint32_t read_uint(const uint8_t* p, int width)
+{
+  switch (width) {
+    case 1:
+      return *p;
+    case 2: {
+      uint16_t x;
+      std::memcpy(&x, p, 2);
+      return x;
+    }
+    default: {
+      uint32_t x;
+      std::memcpy(&x, p, 4);
+      return x;
+    }
+  }
+}
+
+static inline void write_uint(uint8_t* p, int width, uint32_t x)
+{
+  switch (width) {
+    case 1:
+      *p = x;
+      break;
+    case 2: {
+      uint16_t y = x;
+      std::memcpy(p, &y, 2);
+      break;
+    }
+    default:
+      std::memcpy(p, &x, 4);
+  }
+}
+
+ConfigLayout::ConfigLayout(const Graph& _G, size_t _N, int max_goal_index,
+                           int _snapshot_interval)
+    : G(&_G),
+      N(_N),
+      agent_width(get_width(_N)),
+      v_width(get_width(_G.size())),
+      goal_width(get_width(max_goal_index)),
+      snapshot_interval(_snapshot_interval)
+{
+}
+
+size_t ConfigLayout::bytes() const { return N * (v_width + goal_width); }
+
+void ConfigLayout::encode(const Config& C, uint8_t* buf) const
+{
+  auto goal_buf = buf + N * v_width;
+  for (size_t i = 0; i < N; ++i) {
+    write_uint(buf + i * v_width, v_width, C[i]->id);
+    write_uint(goal_buf + i * goal_width, goal_width, C.goal_indices[i]);
+  }
+}
+
+void ConfigLayout::decode(const uint8_t* buf, Config& C) const
+{
+  if (C.size() != N) C = Config(N, nullptr);
+  for (size_t i = 0; i < N; ++i) {
+    C[i] = get_vertex(buf, i);
+    C.goal_indices[i] = get_goal_index(buf, i);
+  }
+}
+
+Vertex* ConfigLayout::get_vertex(const uint8_t* buf, size_t i) const
+{
+  return G->get_vertex(read_uint(buf + i * v_width, v_width));
+}
+
+int ConfigLayout::get_goal_index(const uint8_t* buf, size_t i) const
+{
+  return read_uint(buf + N * v_width + i * goal_width, goal_width);
+}
+
+bool ConfigLayout::equals(const uint8_t* buf, const Config& C) const
+{
+  for (size_t i = 0; i < N; ++i) {
+    if (get_vertex(buf, i) != C[i]) return false;
+    if (get_goal_index(buf, i) != C.goal_indices[i]) return false;
+  }
+  return true;
+}
+
+PackedConfig ConfigLayout::pack(const Config& C, const PackedConfig* base,
+                                const Config* C_base) const
+{
+  if (C_base == nullptr) base = nullptr;
+
+  // count changed agents
+  int num_diffs = 0;
+  if (base != nullptr) {
+    for (size_t i = 0; i < N; ++i) {
+      if (C[i] != (*C_base)[i] ||
+          C.goal_indices[i] != C_base->goal_indices[i]) {
+        ++num_diffs;
       }
     }
   }
+  const size_t diff_bytes = num_diffs * (agent_width + v_width + goal_width);
+
+  // full snapshot
+  if (base == nullptr || base->depth >= snapshot_interval ||
+      diff_bytes >= bytes()) {
+    auto P = PackedConfig{std::make_unique<uint8_t[]>(bytes()), nullptr, 0, 0};
+    encode(C, P.data.get());
+    return P;
+  }
+
+  // diff, [agent ids][vertex ids][goal indices]
+  auto P = PackedConfig{std::make_unique<uint8_t[]>(diff_bytes), base,
+                        num_diffs, base->depth + 1};
+  auto agent_buf = P.data.get();
+  auto v_buf = agent_buf + num_diffs * agent_width;
+  auto goal_buf = v_buf + num_diffs * v_width;
+  int k = 0;
+  for (size_t i = 0; i < N; ++i) {
+    if (C[i] == (*C_base)[i] && C.goal_indices[i] == C_base->goal_indices[i]) {
+      continue;
+    }
+    write_uint(agent_buf + k * agent_width, agent_width, i);
+    write_uint(v_buf + k * v_width, v_width, C[i]->id);
+    write_uint(goal_buf + k * goal_width, goal_width, C.goal_indices[i]);
+    ++k;
+  }
+  return P;
+}
+
+void ConfigLayout::unpack(const PackedConfig& P, Config& C,
+                          const PackedConfig* known) const
+{
+  if (&P == known) return;
+  if (P.base == nullptr) {
+    decode(P.data.get(), C);
+    return;
+  }
+  unpack(*P.base, C, known);
+
+  // apply diff
+  auto agent_buf = P.data.get();
+  auto v_buf = agent_buf + P.num_diffs * agent_width;
+  auto goal_buf = v_buf + P.num_diffs * v_width;
+  for (int k = 0; k < P.num_diffs; ++k) {
+    auto i = read_uint(agent_buf + k * agent_width, agent_width);
+    C[i] = G->get_vertex(read_uint(v_buf + k * v_width, v_width));
+    C.goal_indices[i] = read_uint(goal_buf + k * goal_width, goal_width);
+  }
+}
+
+bool ConfigLayout::equals(const PackedConfig& P, const Config& C,
+                          Config& buf) const
+{
+  if (P.base == nullptr) return equals(P.data.get(), C);
+  unpack(P, buf);
+  return buf == C;
+}
+
+size_t ConfigLayout::bytes(const PackedConfig& P) const
+{
+  if (P.base == nullptr) return bytes();
+  return P.num_diffs * (agent_width + v_width + goal_width);
+}
+
+static inline uint64_t zobrist_vertex(uint64_t i, uint32_t v_id)
+{
+  return mix_hash((i << 32) | v_id);
+}
+
+static inline uint64_t zobrist_goal_index(uint64_t i, uint32_t goal_index)
+{
+  return mix_hash(((i << 32) | goal_index) ^ 0x9e3779b97f4a7c15);
+}
+
+uint64_t ConfigHasher::operator()(const Config& C) const
+{
+  uint64_t hash = 0;
+  for (size_t i = 0; i < C.size(); ++i) {
+    hash ^= zobrist_vertex(i, C[i]->id);
+    hash ^= zobrist_goal_index(i, C.goal_indices[i]);
+  }
+  return hash;
 }
 
-int Graph::size() const { return V.size(); }
+uint64_t ConfigHasher::operator()(const Config& C, const Config& C_prev,
+                                  uint64_t hash_prev) const
+{
+  auto hash = hash_prev;
+  for (size_t i = 0; i < C.size(); ++i) {
+    if (C[i] != C_prev[i]) {
+      hash ^= zobrist_vertex(i, C_prev[i]->id) ^ zobrist_vertex(i, C[i]->id);
+    }
+    if (C.goal_indices[i] != C_prev.goal_indices[i]) {
+      hash ^= zobrist_goal_index(i, C_prev.goal_indices[i]) ^
+              zobrist_goal_index(i, C.goal_indices[i]);
+    }
+  }
+  return hash;
+}
 
-uint ConfigHasher::operator()(const Config& C) const
+uint64_t ConfigHasher::operator()(const Config& C, const Config& C_prev,
+                                  uint64_t hash_prev,
+                                  const std::vector<int>& moved,
+                                  const std::vector<int>& advanced) const
 {
-  uint location_hash = C.size();
-  for (auto& v : C) {
-    location_hash ^=
-        v->id + 0x9e3779b9 + (location_hash << 6) + (location_hash >> 2);
+  auto hash = hash_prev;
+  for (auto i : moved) {
+    hash ^= zobrist_vertex(i, C_prev[i]->id) ^ zobrist_vertex(i, C[i]->id);
   }
-  uint indices_hash = C.goal_indices.size();
-  for (auto& idx : C.goal_indices) {
-    indices_hash ^=
-        idx + 0x9e3779b9 + (indices_hash << 6) + (indices_hash >> 2);
+  for (auto i : advanced) {
+    hash ^= zobrist_goal_index(i, C_prev.goal_indices[i]) ^
+            zobrist_goal_index(i, C.goal_indices[i]);
   }
-  return hash_two_ints(location_hash, indices_hash);
+  return hash;
 }
 
 std::ostream& operator<<(std::ostream& os, const Vertex* v)
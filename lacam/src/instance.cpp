@@ -1,7 +1,16 @@
 #include "../include/instance.hpp"
 
+#include <array>
 #include <set>
 
+// vertex of index (width * y + x), nullptr with a message if unavailable
+static Vertex* get_vertex_by_index(const Graph& G, int k)
+{
+  auto v = G.get_vertex_by_index(k);
+  if (v == nullptr) info(0, 0, "index ", k, " is out of range or blocked");
+  return v;
+}
+
 Instance::Instance(const std::string& map_filename,
                    const std::vector<int>& start_indexes,
                    const std::vector<int>& goal_indexes)
@@ -10,13 +19,18 @@ Instance::Instance(const std::string& map_filename,
       goals(Config()),
       N(start_indexes.size())
 {
-  for (auto k : start_indexes) starts.push_back(G.U[k], 0);
+  // invalid indexes are skipped, then is_valid() fails
+  for (auto k : start_indexes) {
+    auto vp = get_vertex_by_index(G, k);
+    if (vp != nullptr) starts.push_back(vp, 0);
+  }
   for (auto k : goal_indexes) {
-    auto vp = G.U[k];
+    auto vp = get_vertex_by_index(G, k);
+    if (vp == nullptr) continue;
     goals.push_back(vp, 0);
     goal_sequences.push_back(std::vector<Vertex*>{vp});
   }
-  starts.goal_indices = calculate_goal_indices(starts, starts);
+  if (is_valid()) starts.goal_indices = calculate_goal_indices(starts, starts);
 }
 
 Instance::Instance(const std::string& map_filename,
@@ -27,51 +41,81 @@ Instance::Instance(const std::string& map_filename,
       goals(Config()),
       N(start_indexes.size())
 {
-  for (auto k : start_indexes) starts.push_back(G.U[k], 0);
+  // invalid indexes are skipped, then is_valid() fails
+  for (auto k : start_indexes) {
+    auto vp = get_vertex_by_index(G, k);
+    if (vp != nullptr) starts.push_back(vp, 0);
+  }
   for (auto goal_sequence : goal_index_sequences) {
     std::vector<Vertex*> as_vertices;
-    for (auto k : goal_sequence) as_vertices.push_back(G.U[k]);
+    for (auto k : goal_sequence) {
+      auto vp = get_vertex_by_index(G, k);
+      if (vp != nullptr) as_vertices.push_back(vp);
+    }
+    if (as_vertices.size() != goal_sequence.size() || as_vertices.empty()) {
+      continue;
+    }
     goal_sequences.push_back(as_vertices);
     goals.push_back(as_vertices.back(), as_vertices.size() - 1);
   }
-  starts.goal_indices = calculate_goal_indices(starts, starts);
+  if (is_valid()) starts.goal_indices = calculate_goal_indices(starts, starts);
 }
 
-// for load instance
-static const std::regex r_instance =
-    std::regex(R"(\d+\t.+\.map\t\d+\t\d+\t(\d+)\t(\d+)\t(\d+)\t(\d+)\t.+)");
+// one line of MovingAI scenario files, i.e.,
+// bucket \t map \t width \t height \t x_s \t y_s \t x_g \t y_g \t optimal
+static bool parse_scen_line(std::string_view line, int& x_s, int& y_s,
+                            int& x_g, int& y_g)
+{
+  std::array<std::string_view, 9> fields;
+  for (size_t k = 0; k < fields.size(); ++k) {
+    auto pos = (k + 1 < fields.size()) ? line.find('\t') : line.size();
+    if (pos == std::string_view::npos) return false;
+    fields[k] = line.substr(0, pos);
+    line.remove_prefix(pos == line.size() ? pos : pos + 1);
+  }
+  int bucket, width, height;
+  return parse_uint(fields[0], bucket) && fields[1].size() > 4 &&
+         fields[1].substr(fields[1].size() - 4) == ".map" &&
+         parse_uint(fields[2], width) && parse_uint(fields[3], height) &&
+         parse_uint(fields[4], x_s) && parse_uint(fields[5], y_s) &&
+         parse_uint(fields[6], x_g) && parse_uint(fields[7], y_g) &&
+         !fields[8].empty();
+}
 
 Instance::Instance(const std::string& scen_filename,
-                   const std::string& map_filename, const int _N)
-    : G(Graph(map_filename)), starts(Config()), goals(Config()), N(_N)
+                   const std::string& map_filename, const int _N,
+                   bool implicit_graph)
+    : G(map_filename, implicit_graph),
+      starts(Config()),
+      goals(Config()),
+      N(_N)
 {
   // load start-goal pairs
-  std::ifstream file(scen_filename);
-  if (!file) {
+  auto file = MappedFile(scen_filename);
+  if (!file.is_open) {
     info(0, 0, scen_filename, " is not found");
     return;
   }
-  std::string line;
-  std::smatch results;
-
-  while (getline(file, line)) {
-    // for CRLF coding
-    if (*(line.end() - 1) == 0x0d) line.pop_back();
-
-    if (std::regex_match(line, results, r_instance)) {
-      auto x_s = std::stoi(results[1].str());
-      auto y_s = std::stoi(results[2].str());
-      auto x_g = std::stoi(results[3].str());
-      auto y_g = std::stoi(results[4].str());
-      if (x_s < 0 || G.width <= x_s || x_g < 0 || G.width <= x_g) continue;
-      if (y_s < 0 || G.height <= y_s || y_g < 0 || G.height <= y_g) continue;
-      auto s = G.U[G.width * y_s + x_s];
-      auto g = G.U[G.width * y_g + x_g];
-      if (s == nullptr || g == nullptr) continue;
-      starts.push_back(s, 0);
-      goals.push_back(g, 0);
-      goal_sequences.push_back(std::vector<Vertex*>{g});
+  auto reader = LineReader(file.data, file.size);
+  std::string_view line;
+
+  while (reader.next(line)) {
+    int x_s, y_s, x_g, y_g;
+    if (!parse_scen_line(line, x_s, y_s, x_g, y_g)) {
+      if (!line.empty() && line.substr(0, 7) != "version") {
+        info(0, 0, scen_filename, ":", reader.line_number,
+             ": invalid scenario line, skipped");
+      }
+      continue;
     }
+    if (G.width <= x_s || G.width <= x_g) continue;
+    if (G.height <= y_s || G.height <= y_g) continue;
+    auto s = G.get_vertex_by_index(G.width * y_s + x_s);
+    auto g = G.get_vertex_by_index(G.width * y_g + x_g);
+    if (s == nullptr || g == nullptr) continue;
+    starts.push_back(s, 0);
+    goals.push_back(g, 0);
+    goal_sequences.push_back(std::vector<Vertex*>{g});
 
     if (starts.size() == N) break;
   }
@@ -79,8 +123,11 @@ Instance::Instance(const std::string& scen_filename,
 }
 
 Instance::Instance(const std::string& map_filename, std::mt19937* MT,
-                   const int _N)
-    : G(Graph(map_filename)), starts(Config()), goals(Config()), N(_N)
+                   const int _N, bool implicit_graph)
+    : G(map_filename, implicit_graph),
+      starts(Config()),
+      goals(Config()),
+      N(_N)
 {
   // random assignment
   const auto K = G.size();
@@ -92,7 +139,7 @@ Instance::Instance(const std::string& map_filename, std::mt19937* MT,
   int i = 0;
   while (true) {
     if (i >= K) return;
-    starts.push_back(G.V[s_indexes[i]], 0);
+    starts.push_back(G.get_vertex(s_indexes[i]), 0);
     if (starts.size() == N) break;
     ++i;
   }
@@ -104,7 +151,7 @@ Instance::Instance(const std::string& map_filename, std::mt19937* MT,
   int j = 0;
   while (true) {
     if (j >= K) return;
-    auto vp = G.V[g_indexes[j]];
+    auto vp = G.get_vertex(g_indexes[j]);
     goals.push_back(vp, 0);
     goal_sequences.push_back(std::vector<Vertex*>{vp});
     if (goals.size() == N) break;
@@ -133,6 +180,15 @@ int Instance::get_total_goals() const
   return total_goals;
 }
 
+int Instance::get_max_goal_index() const
+{
+  int max_goal_index = 0;
+  for (const auto& goals : goal_sequences) {
+    max_goal_index = std::max(max_goal_index, (int)goals.size());
+  }
+  return max_goal_index;
+}
+
 bool Instance::is_goal_config(const Config& C) const
 {
   if (!C.enough_goals_reached(get_total_goals())) return false;
@@ -142,17 +198,18 @@ bool Instance::is_goal_config(const Config& C) const
   return true;
 }
 
-std::vector<int> Instance::calculate_goal_indices(const Config& c,
-                                                  const Config& c_prev) const
+std::vector<int> Instance::calculate_goal_indices(
+    const Config& c, const Config& c_prev, std::vector<int>* advanced) const
 {
   auto goal_indices = c_prev.goal_indices;
   for (size_t i = 0; i < N; ++i) {
     const auto current_location = c[i];
-    const auto goal_seq = goal_sequences[i];
+    const auto& goal_seq = goal_sequences[i];
     auto& goal_idx = goal_indices[i];
-    const auto next_goal = goal_seq[goal_indices[i]];
-    if (current_location == next_goal && goal_idx < (int)goal_seq.size()) {
+    if (goal_idx < (int)goal_seq.size() &&
+        current_location == goal_seq[goal_idx]) {
       goal_idx += 1;
+      if (advanced != nullptr) advanced->push_back(i);
     }
   }
   return goal_indices;
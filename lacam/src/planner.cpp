@@ -1,173 +1,650 @@
 #include "../include/planner.hpp"
 
-Constraint::Constraint() : who(std::vector<int>()), where(Vertices()), depth(0)
+#include <mutex>
+#include <thread>
+
+Constraint::Constraint() : parent(nullptr), who(-1), where(nullptr), depth(0)
 {
 }
 
-Constraint::Constraint(Constraint* parent, int i, Vertex* v)
-    : who(parent->who), where(parent->where), depth(parent->depth + 1)
+Constraint::Constraint(Constraint* _parent, int i, Vertex* v)
+    : parent(_parent), who(i), where(v), depth(_parent->depth + 1)
 {
-  who.push_back(i);
-  where.push_back(v);
 }
 
-Constraint::~Constraint(){};
-
-Node::Node(Config _C, DistTableMultiGoal& D, Node* _parent)
-    : C(_C),
+Node::Node(const Config& _C, uint64_t _hash, const ConfigLayout& layout,
+           DistTableMultiGoal& D, Node* _parent, const Config* C_parent,
+           const std::vector<float>* priorities_parent)
+    : C(layout.pack(_C, _parent == nullptr ? nullptr : &_parent->C,
+                    C_parent)),
+      hash(_hash),
       parent(_parent),
-      priorities(C.size(), 0),
-      order(C.size(), 0),
-      search_tree(std::queue<Constraint*>())
+      priorities(),
+      priorities_depth(_parent == nullptr ? 0 : _parent->priorities_depth + 1),
+      search_tree(std::queue<Constraint*>()),
+      g(0),
+      h(0),
+      neighbors()
 {
-  search_tree.push(new Constraint());
-  const auto N = C.size();
+  // store priorities every snapshot_interval steps, like configurations
+  if (parent != nullptr && (priorities_depth < layout.snapshot_interval ||
+                            priorities_parent == nullptr)) {
+    return;
+  }
+  priorities_depth = 0;
+  set_priorities(_C, D, priorities_parent, priorities);
+}
 
-  // set priorities
-  if (parent == nullptr) {
+void Node::set_priorities(const Config& C, DistTableMultiGoal& D,
+                          const std::vector<float>* priorities_parent,
+                          std::vector<float>& priorities)
+{
+  const auto N = C.size();
+  priorities.resize(N);
+  if (priorities_parent == nullptr) {
     // initialize
     for (size_t i = 0; i < N; ++i) {
       priorities[i] = (float)D.get(i, C.goal_indices[i], C[i]) / N;
     }
   } else {
     // dynamic priorities, akin to PIBT
+    const auto& P = *priorities_parent;
     for (size_t i = 0; i < N; ++i) {
-      if (D.get(i, C.goal_indices[i], C[i]) != 0) {
-        priorities[i] = parent->priorities[i] + 1;
+      if (D.get_goal(i, C.goal_indices[i]) != C[i]) {  // not at the goal
+        priorities[i] = P[i] + 1;
       } else {
-        priorities[i] = parent->priorities[i] - (int)parent->priorities[i];
+        priorities[i] = P[i] - (int)P[i];
       }
     }
   }
+}
 
-  // set order
-  std::iota(order.begin(), order.end(), 0);
-  std::sort(order.begin(), order.end(),
-            [&](int i, int j) { return priorities[i] > priorities[j]; });
+Node::~Node() {}
+
+void Node::release()
+{
+  std::vector<float>().swap(priorities);
 }
 
-Node::~Node()
+size_t Node::bytes(const ConfigLayout& layout) const
 {
-  while (!search_tree.empty()) {
-    delete search_tree.front();
-    search_tree.pop();
-  }
+  // the buffer of search_tree is not counted, it depends on the library
+  return sizeof(Node) + layout.bytes(C) +
+         priorities.capacity() * sizeof(float) +
+         neighbors.capacity() * sizeof(std::pair<Node*, int>);
 }
 
 Planner::Planner(const Instance* _ins, const Deadline* _deadline,
                  std::mt19937* _MT, int _verbose, std::optional<int> _threshold,
-                 bool _allow_following)
+                 bool _allow_following,
+                 std::shared_ptr<DistTableMultiGoal> _D)
     : ins(_ins),
       deadline(_deadline),
       MT(_MT),
       verbose(_verbose),
       threshold(_threshold),
       allow_following(_allow_following),
+      cancel(nullptr),
+      num_workers(1),
+      anytime(false),
       N(ins->N),
       V_size(ins->G.size()),
-      D(DistTableMultiGoal(ins)),
-      C_next(Candidates(N, std::array<Vertex*, 5>())),
+      layout(ins->G, N, ins->get_max_goal_index()),
+      D(_D != nullptr ? _D : std::make_shared<DistTableMultiGoal>(ins)),
+      C_next(Candidates(N, Vertices(ins->G.max_degree + 1))),
       tie_breakers(std::vector<float>(V_size, 0)),
       A(Agents(N, nullptr)),
       occupied_now(Agents(V_size, nullptr)),
-      occupied_next(Agents(V_size, nullptr))
+      occupied_next(Agents(V_size, nullptr)),
+      C_now(),
+      S_now(nullptr),
+      order_now(),
+      S_order(nullptr),
+      moved(),
+      advanced(),
+      priorities_now(),
+      S_priorities(nullptr),
+      priorities_buf(),
+      C_buf(),
+      nodes_buf(),
+      NODES(),
+      CONSTRAINTS(),
+      CLOSED(&layout),
+      hint(),
+      hint_node(nullptr),
+      hint_step(0),
+      refinements()
+{
+}
+
+// probability to restart from the initial node in the anytime mode
+static constexpr float RESTART_RATE = 0.001;
+
+// every agent stays or moves to a neighbor, collisions are not checked
+static bool is_transition(const Config& C, const Config& C_next)
 {
+  if (C.size() != C_next.size()) return false;
+  for (size_t i = 0; i < C.size(); ++i) {
+    if (C[i] == C_next[i]) continue;
+    const auto& neighbor = C[i]->neighbor;
+    if (std::find(neighbor.begin(), neighbor.end(), C_next[i]) ==
+        neighbor.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Node* Planner::create_node(const Config& C, uint64_t hash, Node* parent,
+                           const Config* C_parent)
+{
+  auto S = NODES.create(C, hash, layout, *D, parent, C_parent,
+                        parent == nullptr ? nullptr : &get_priorities(parent));
+  auto root = CONSTRAINTS.create();
+  if (anytime) {
+    S->h = get_h_value(C);
+    if (parent != nullptr && C_parent != nullptr) {
+      const auto cost = get_edge_cost(*C_parent, C);
+      S->g = parent->g + cost;
+      parent->neighbors.emplace_back(S, cost);
+    }
+  }
+
+  // follow the hint first, the usual low-level search remains as fallback
+  if (parent == hint_node && hint_step < hint.size() &&
+      std::equal(C.begin(), C.end(), hint[hint_step].begin())) {
+    hint_node = S;
+    hint_step += 1;
+    if (hint_step < hint.size() && is_transition(C, hint[hint_step])) {
+      auto M = root;
+      for (auto i = 0; i < N; ++i) {
+        M = CONSTRAINTS.create(M, i, hint[hint_step][i]);
+      }
+      S->search_tree.push(M);
+    }
+  }
+
+  S->search_tree.push(root);
+  return S;
+}
+
+void Planner::setup_hint()
+{
+  hint_node = nullptr;
+  hint_step = 0;
+
+  // every configuration must consist of N vertices of the graph
+  for (const auto& C : hint) {
+    if (C.size() == (size_t)N &&
+        std::all_of(C.begin(), C.end(), [&](Vertex* v) {
+          return v != nullptr && v->id >= 0 && v->id < V_size;
+        })) {
+      continue;
+    }
+    info(1, verbose, "hint: invalid configuration, dropped");
+    hint.clear();
+    return;
+  }
+
+  // the hint is used from the first configuration equal to the starts
+  while (hint_step < hint.size() &&
+         !std::equal(ins->starts.begin(), ins->starts.end(),
+                     hint[hint_step].begin())) {
+    hint_step += 1;
+  }
+  if (!hint.empty()) {
+    info(1, verbose, "hint: ", hint.size() - hint_step, " steps");
+  }
 }
 
 Solution Planner::solve()
 {
+  if (num_workers > 1 && !anytime) return solve_parallel();
+  if (num_workers > 1) info(1, verbose, "anytime mode, num_workers ignored");
   info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tstart search");
 
   // setup agents
   for (auto i = 0; i < N; ++i) A[i] = new Agent(i);
+  std::fill(occupied_now.begin(), occupied_now.end(), nullptr);
+  std::fill(occupied_next.begin(), occupied_next.end(), nullptr);
+  S_now = nullptr;
+  S_priorities = nullptr;
+  S_order = nullptr;
+  setup_hint();
 
   // setup search queues
   std::stack<Node*> OPEN;
-  std::unordered_map<Config, Node*, ConfigHasher> CLOSED;
-  std::vector<Constraint*> GC;  // garbage collection of constraints
 
   // insert initial node
   auto initial_config = ins->starts;
   // initial_config.goal_indices =
   //     calculate_goal_indices(ins, initial_config, initial_config);
-  auto S = new Node(initial_config, D);
+  auto S = create_node(initial_config, ConfigHasher()(initial_config));
   OPEN.push(S);
-  CLOSED[S->C] = S;
+  CLOSED.insert(S, S->hash);
+  const auto S_init = S;
 
   // depth first search
   int loop_cnt = 0;
   std::vector<Config> solution;
-
-  while (!OPEN.empty() && !is_expired(deadline)) {
+  Node* S_goal = nullptr;  // best goal node, for the anytime mode
+  refinements.clear();
+  auto report = [&]() {
+    refinements.emplace_back(elapsed_ms(deadline), S_goal->g);
+    info(1, verbose, "elapsed:", elapsed_ms(deadline),
+         "ms\tsolution cost: ", S_goal->g);
+  };
+
+  while (!OPEN.empty() && !is_expired(deadline) &&
+         !(cancel != nullptr && cancel->load(std::memory_order_relaxed))) {
     loop_cnt += 1;
 
     // do not pop here!
     S = OPEN.top();
 
+    // prune by the lower bound, for the anytime mode
+    if (S_goal != nullptr && S->g + S->h >= S_goal->g) {
+      OPEN.pop();
+      continue;
+    }
+    const auto& C_S = get_config(S);
+
     // check goal condition
-    auto goal_reached = threshold.has_value() ? S->C.enough_goals_reached(threshold.value()) : ins->is_goal_config(S->C);
+    auto goal_reached = threshold.has_value() ? C_S.enough_goals_reached(threshold.value()) : ins->is_goal_config(C_S);
+    if (goal_reached && anytime) {
+      // keep searching for cheaper solutions
+      if (S_goal == nullptr || S->g < S_goal->g) {
+        S_goal = S;
+        report();
+      }
+      OPEN.pop();
+      continue;
+    }
     if (goal_reached) {
       // backtrack
       while (S != nullptr) {
-        solution.push_back(S->C);
+        solution.push_back(get_config(S));
         S = S->parent;
       }
       std::reverse(solution.begin(), solution.end());
       break;
     }
 
-    // low-level search end
+    // low-level search end, S creates no more successors
     if (S->search_tree.empty()) {
       OPEN.pop();
+      S->release();
       continue;
     }
 
     // create successors at the low-level search
     auto M = S->search_tree.front();
-    GC.push_back(M);
     S->search_tree.pop();
     if (M->depth < N) {
-      auto i = S->order[M->depth];
-      auto C = S->C[i]->neighbor;
-      C.push_back(S->C[i]);
+      auto i = get_order(S)[M->depth];
+      const auto& neighbor = C_S[i]->neighbor;
+      auto C = Vertices(neighbor.begin(), neighbor.end());
+      C.push_back(C_S[i]);
       if (MT != nullptr) std::shuffle(C.begin(), C.end(), *MT);  // randomize
-      for (auto u : C) S->search_tree.push(new Constraint(M, i, u));
+      for (auto u : C) S->search_tree.push(CONSTRAINTS.create(M, i, u));
     }
 
     // create successors at the high-level search
-    if (!get_new_config(S, M)) continue;
+    if (!get_new_config(S, C_S, M)) continue;
 
     // create new configuration
-    auto C = Config(N, nullptr);
-    for (auto a : A) C[a->id] = a->v_next;
-    C.goal_indices = ins->calculate_goal_indices(C, S->C);
+    uint64_t hash;
+    const auto C = get_next_config(C_S, S->hash, hash);
 
     // check explored list
-    auto iter = CLOSED.find(C);
-    if (iter != CLOSED.end()) {
-      OPEN.push(iter->second);
+    auto S_known = CLOSED.find(C, hash);
+    if (S_known != nullptr && anytime) {
+      // a new edge may shorten paths to known nodes
+      const auto cost = get_edge_cost(C_S, C);
+      auto& neighbors = S->neighbors;
+      if (std::find(neighbors.begin(), neighbors.end(),
+                    std::make_pair(S_known, cost)) == neighbors.end()) {
+        neighbors.emplace_back(S_known, cost);
+      }
+      const auto cost_best = S_goal == nullptr ? INT_MAX : S_goal->g;
+      rewire(S, OPEN, S_goal);
+      if (S_goal != nullptr && S_goal->g < cost_best) report();
+
+      // occasional restart from the initial node, for diversity
+      if (MT != nullptr && get_random_float(MT) < RESTART_RATE) {
+        S_known = S_init;
+      }
+      if (S_goal == nullptr || S_known->g + S_known->h < S_goal->g) {
+        OPEN.push(S_known);
+      }
+      continue;
+    }
+    if (S_known != nullptr) {
+      OPEN.push(S_known);
       continue;
     }
 
     // insert new search node
-    auto S_new = new Node(C, D, S);
-    OPEN.push(S_new);
-    CLOSED[S_new->C] = S_new;
+    auto S_new = create_node(C, hash, S, &C_S);
+    if (S_goal == nullptr || S_new->g + S_new->h < S_goal->g) OPEN.push(S_new);
+    CLOSED.insert(S_new, hash);
+  }
+
+  // the best solution of the anytime mode, parents may have been rewired
+  for (S = S_goal; S != nullptr; S = S->parent) {
+    solution.push_back(get_config(S));
   }
+  if (S_goal != nullptr) std::reverse(solution.begin(), solution.end());
 
   info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\t",
        solution.empty() ? (OPEN.empty() ? "no solution" : "failed")
                         : "solution found",
        "\tloop_itr:", loop_cnt, "\texplored:", CLOSED.size());
+  info(2, verbose, "closed table\tload_factor:", CLOSED.load_factor(),
+       "\tavg_probe:", CLOSED.average_probe_length(),
+       "\tmax_probe:", CLOSED.max_probe_length);
+  if (verbose >= 2 && NODES.size() > 0) {
+    size_t bytes = 0;
+    NODES.for_each([&](const Node& S) { bytes += S.bytes(layout); });
+    info(2, verbose, "nodes\tbytes per node:", bytes / NODES.size());
+  }
   // memory management
   for (auto a : A) delete a;
-  for (auto M : GC) delete M;
-  for (auto p : CLOSED) delete p.second;
+  CLOSED.clear();
+  NODES.clear();
+  CONSTRAINTS.clear();
 
   return solution;
 }
 
-bool Planner::get_new_config(Node* S, Constraint* M)
+// OPEN is a stack shared by all workers, guarded by one mutex
+// a worker takes one constraint of the top node at a time, then expands it
+// outside the lock, i.e., PIBT, hashing and node creation run in parallel
+// nodes are not released until the search ends, since workers rebuild
+// priorities from ancestors without locks, c.f., get_priorities
+struct ParallelSearch {
+  std::mutex mutex;
+  std::stack<Node*> OPEN;
+  ConcurrentClosedTable CLOSED;
+  int num_active;              // workers expanding a node, guarded by mutex
+  std::atomic<bool> finished;  // solution found or OPEN exhausted
+  std::atomic<int> loop_cnt;
+  std::vector<Config> solution;
+
+  ParallelSearch(const ConfigLayout* layout)
+      : mutex(),
+        OPEN(),
+        CLOSED(layout),
+        num_active(0),
+        finished(false),
+        loop_cnt(0),
+        solution()
+  {
+  }
+};
+
+Solution Planner::solve_parallel()
+{
+  info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tstart search with ",
+       num_workers, " workers");
+
+  // lazy distance tables are filled by all workers
+  const auto concurrent = D->concurrent;
+  D->concurrent = true;
+
+  // helpers have their own PIBT buffers and node storage
+  std::vector<std::mt19937> MTs;
+  for (int k = 1; k < num_workers; ++k) {
+    MTs.emplace_back(MT != nullptr ? (*MT)() : k);
+  }
+  std::vector<std::unique_ptr<Planner>> helpers;
+  for (int k = 1; k < num_workers; ++k) {
+    helpers.push_back(std::make_unique<Planner>(
+        ins, deadline, MT != nullptr ? &MTs[k - 1] : nullptr, 0, threshold,
+        allow_following, D));
+    helpers.back()->cancel = cancel;
+  }
+
+  // insert initial node
+  setup_hint();
+  ParallelSearch P(&layout);
+  const auto& initial_config = ins->starts;
+  const auto hash = ConfigHasher()(initial_config);
+  auto S = P.CLOSED
+               .find_or_insert(initial_config, hash,
+                               [&]() {
+                                 return create_node(initial_config, hash);
+                               })
+               .first;
+  P.OPEN.push(S);
+
+  std::vector<std::thread> threads;
+  for (auto& helper : helpers) {
+    threads.emplace_back([&P, &helper]() { helper->search_worker(P); });
+  }
+  search_worker(P);
+  for (auto& th : threads) th.join();
+  D->concurrent = concurrent;
+
+  info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\t",
+       P.solution.empty() ? (P.OPEN.empty() ? "no solution" : "failed")
+                          : "solution found",
+       "\tloop_itr:", P.loop_cnt.load(), "\texplored:", P.CLOSED.size());
+
+  // memory management, nodes of helpers are released with them
+  P.CLOSED.clear();
+  NODES.clear();
+  CONSTRAINTS.clear();
+  return P.solution;
+}
+
+void Planner::search_worker(ParallelSearch& P)
+{
+  for (auto i = 0; i < N; ++i) A[i] = new Agent(i);
+  std::fill(occupied_now.begin(), occupied_now.end(), nullptr);
+  std::fill(occupied_next.begin(), occupied_next.end(), nullptr);
+  S_now = nullptr;
+  S_priorities = nullptr;
+  S_order = nullptr;
+
+  while (!P.finished && !is_expired(deadline) &&
+         !(cancel != nullptr && cancel->load(std::memory_order_relaxed))) {
+    // take one constraint of the top node
+    Node* S = nullptr;
+    Constraint* M = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(P.mutex);
+      if (P.OPEN.empty()) {
+        // others may still push nodes
+        if (P.num_active == 0) P.finished = true;
+      } else if (P.OPEN.top()->search_tree.empty()) {
+        // not released, other workers may still create its successors or
+        // rebuild priorities of its descendants from it
+        P.OPEN.pop();
+        continue;
+      } else {
+        S = P.OPEN.top();
+        M = S->search_tree.front();
+        S->search_tree.pop();
+        P.num_active += 1;
+      }
+    }
+    if (S == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    P.loop_cnt += 1;
+    const auto& C_S = get_config(S);
+
+    // check goal condition
+    auto goal_reached = threshold.has_value()
+                            ? C_S.enough_goals_reached(threshold.value())
+                            : ins->is_goal_config(C_S);
+    if (goal_reached) {
+      if (!P.finished.exchange(true)) {
+        std::vector<Config> solution;
+        for (; S != nullptr; S = S->parent) solution.push_back(get_config(S));
+        std::reverse(solution.begin(), solution.end());
+        P.solution = std::move(solution);
+      }
+      break;
+    }
+
+    // create successors at the low-level search
+    // S may be popped meanwhile by others, then it is pushed again
+    if (M->depth < N) {
+      auto i = get_order(S)[M->depth];
+      const auto& neighbor = C_S[i]->neighbor;
+      auto C = Vertices(neighbor.begin(), neighbor.end());
+      C.push_back(C_S[i]);
+      if (MT != nullptr) std::shuffle(C.begin(), C.end(), *MT);  // randomize
+      auto children = std::vector<Constraint*>();
+      for (auto u : C) children.push_back(CONSTRAINTS.create(M, i, u));
+      std::lock_guard<std::mutex> lock(P.mutex);
+      for (auto m : children) S->search_tree.push(m);
+      if (P.OPEN.empty() || P.OPEN.top() != S) P.OPEN.push(S);
+    }
+
+    // create successors at the high-level search
+    Node* S_next = nullptr;
+    if (get_new_config(S, C_S, M)) {
+      uint64_t hash;
+      const auto C = get_next_config(C_S, S->hash, hash);
+      Node* S_new = nullptr;
+      S_next = P.CLOSED
+                   .find_or_insert(C, hash,
+                                   [&]() {
+                                     S_new = create_node(C, hash, S, &C_S);
+                                     return S_new;
+                                   })
+                   .first;
+      // lost the race of insertion, the duplicate is returned to the pool
+      // and the hint is followed from the winner
+      if (S_new != nullptr && S_new != S_next) {
+        if (hint_node == S_new) hint_node = S_next;
+        NODES.destroy_last();
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(P.mutex);
+    if (S_next != nullptr) P.OPEN.push(S_next);
+    P.num_active -= 1;
+  }
+
+  for (auto a : A) delete a;
+}
+
+// sum of loss w.r.t. the goal sequences, i.e., agents staying at their last
+// goal after reaching all goals cost nothing; this is what the anytime mode
+// optimizes; with a threshold, get_sum_of_loss of the solution differs since
+// it takes the final configuration as goals, which is unknown during search
+int Planner::get_edge_cost(const Config& C_from, const Config& C_to) const
+{
+  int cost = 0;
+  for (auto i = 0; i < N; ++i) {
+    const auto& goal_sequence = ins->goal_sequences[i];
+    if (C_from[i] != C_to[i] || C_to[i] != goal_sequence.back() ||
+        C_from.goal_indices[i] < (int)goal_sequence.size()) {
+      cost += 1;
+    }
+  }
+  return cost;
+}
+
+// admissible for the whole goal sequences, not for thresholds
+int Planner::get_h_value(const Config& C)
+{
+  if (threshold.has_value()) return 0;
+  int h = 0;
+  for (auto i = 0; i < N; ++i) h += D->get(i, C.goal_indices[i], C[i]);
+  return h;
+}
+
+// propagate cheaper costs from S_from, c.f., LaCAM*
+// unit-like edge costs, hence a FIFO queue is enough
+void Planner::rewire(Node* S_from, std::stack<Node*>& OPEN, Node* S_goal)
+{
+  std::queue<Node*> Q;
+  Q.push(S_from);
+  while (!Q.empty()) {
+    auto S = Q.front();
+    Q.pop();
+    for (auto& [S_to, cost] : S->neighbors) {
+      if (S->g + cost >= S_to->g) continue;
+      S_to->g = S->g + cost;
+      S_to->parent = S;
+      Q.push(S_to);
+      if (S_goal != nullptr && S_to->g + S_to->h < S_goal->g) OPEN.push(S_to);
+    }
+  }
+}
+
+const Config& Planner::get_config(Node* S)
+{
+  if (S != S_now) {
+    layout.unpack(S->C, C_now, S_now == nullptr ? nullptr : &S_now->C);
+    S_now = S;
+  }
+  return C_now;
+}
+
+const std::vector<float>& Planner::get_priorities(Node* S)
+{
+  if (!S->priorities.empty()) return S->priorities;
+  if (S == S_priorities) return priorities_now;
+
+  // path from the nearest node with known priorities, or from the root
+  auto& path = nodes_buf;
+  path.clear();
+  auto T = S;
+  for (; T != nullptr && T != S_priorities && T->priorities.empty();
+       T = T->parent) {
+    path.push_back(T);
+  }
+  const std::vector<float>* P = nullptr;
+  if (T != nullptr) P = T == S_priorities ? &priorities_now : &T->priorities;
+
+  // replay along the path, configurations are decoded in C_buf
+  for (auto k = (int)path.size() - 1; k >= 0; --k) {
+    const auto known = k + 1 < (int)path.size() ? &path[k + 1]->C : nullptr;
+    layout.unpack(path[k]->C, C_buf, known);
+    Node::set_priorities(C_buf, *D, P, priorities_buf);
+    std::swap(priorities_now, priorities_buf);
+    P = &priorities_now;
+  }
+  S_priorities = S;
+  return priorities_now;
+}
+
+const std::vector<int>& Planner::get_order(Node* S)
+{
+  if (S != S_order) {
+    const auto& P = get_priorities(S);
+    order_now.resize(P.size());
+    std::iota(order_now.begin(), order_now.end(), 0);
+    std::sort(order_now.begin(), order_now.end(),
+              [&](int i, int j) { return P[i] > P[j]; });
+    S_order = S;
+  }
+  return order_now;
+}
+
+Config Planner::get_next_config(const Config& C_S, uint64_t hash_S,
+                                uint64_t& hash)
+{
+  auto C = Config(N, nullptr);
+  moved.clear();
+  for (auto a : A) {
+    C[a->id] = a->v_next;
+    if (a->v_next != a->v_now) moved.push_back(a->id);
+  }
+  advanced.clear();
+  C.goal_indices = ins->calculate_goal_indices(C, C_S, &advanced);
+  hash = ConfigHasher()(C, C_S, hash_S, moved, advanced);
+  return C;
+}
+
+bool Planner::get_new_config(Node* S, const Config& C, Constraint* M)
 {
   // setup cache
   for (auto a : A) {
@@ -181,21 +658,21 @@ bool Planner::get_new_config(Node* S, Constraint* M)
     }
 
     // set occupied now
-    a->v_now = S->C[a->id];
+    a->v_now = C[a->id];
     occupied_now[a->v_now->id] = a;
   }
 
-  // add constraints
-  for (auto k = 0; k < M->depth; ++k) {
-    const auto i = M->who[k];        // agent
-    const auto l = M->where[k]->id;  // loc
+  // add constraints, from the newest one to the root
+  for (auto m = M; m->parent != nullptr; m = m->parent) {
+    const auto i = m->who;        // agent
+    const auto l = m->where->id;  // loc
 
     // check vertex collision
     if (occupied_next[l] != nullptr) return false;
 
     if (allow_following) {
       // check swap collision
-      auto l_pre = S->C[i]->id;
+      auto l_pre = C[i]->id;
       if (occupied_next[l_pre] != nullptr && occupied_now[l] != nullptr &&
           occupied_next[l_pre]->id == occupied_now[l]->id) {
         return false;
@@ -206,14 +683,14 @@ bool Planner::get_new_config(Node* S, Constraint* M)
     }
 
     // set occupied_next
-    A[i]->v_next = M->where[k];
+    A[i]->v_next = m->where;
     occupied_next[l] = A[i];
   }
 
   // perform PIBT
-  for (auto k : S->order) {
+  for (auto k : get_order(S)) {
     auto a = A[k];
-    if (a->v_next == nullptr && !funcPIBT(a, S->C.goal_indices))
+    if (a->v_next == nullptr && !funcPIBT(a, C.goal_indices))
       return false;  // planning failure
   }
   return true;
@@ -241,8 +718,8 @@ bool Planner::funcPIBT(Agent* ai, const std::vector<int>& goal_indices,
   // sort
   std::sort(C_next[i].begin(), C_next[i].begin() + num_candidates,
             [&](Vertex* const v, Vertex* const u) {
-              return D.get(i, goal_indices[i], v) + tie_breakers[v->id] <
-                     D.get(i, goal_indices[i], u) + tie_breakers[u->id];
+              return D->get(i, goal_indices[i], v) + tie_breakers[v->id] <
+                     D->get(i, goal_indices[i], u) + tie_breakers[u->id];
             });
 
   for (size_t k = 0; k < num_candidates; ++k) {
@@ -297,12 +774,89 @@ bool Planner::funcPIBT(Agent* ai, const std::vector<int>& goal_indices,
   return false;
 }
 
+// options of distance tables, before search
+static void setup_dist_table(DistTableMultiGoal& D, const Instance& ins,
+                             const int verbose, const Deadline* deadline,
+                             const Precompute precompute,
+                             const int num_threads,
+                             const std::string& dist_cache_dir,
+                             const bool compress_dist_table)
+{
+  D.compress_finished = compress_dist_table;
+  if (!dist_cache_dir.empty()) D.use_cache(dist_cache_dir, ins.G);
+  if (precompute != Precompute::NONE) {
+    const auto t = D.precompute(precompute, num_threads);
+    info(1, verbose, "elapsed:", elapsed_ms(deadline),
+         "ms\tprecomputed distance tables in ", t, "ms");
+  }
+}
+
 Solution solve(const Instance& ins, const int verbose, const Deadline* deadline,
                std::mt19937* MT, const std::optional<int> threshold,
-               const bool allow_following)
+               const bool allow_following, const Precompute precompute,
+               const int num_threads, const std::string& dist_cache_dir,
+               const bool compress_dist_table,
+               std::shared_ptr<DistTableMultiGoal> D, const int num_workers,
+               const bool anytime)
 {
   info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tpre-processing");
   auto planner =
-      Planner(&ins, deadline, MT, verbose, threshold, allow_following);
-  return planner.solve();
+      Planner(&ins, deadline, MT, verbose, threshold, allow_following, D);
+  planner.num_workers = num_workers > 0
+                            ? num_workers
+                            : std::max(1u, std::thread::hardware_concurrency());
+  planner.anytime = anytime;
+  setup_dist_table(*planner.D, ins, verbose, deadline, precompute,
+                   num_threads, dist_cache_dir, compress_dist_table);
+  auto solution = planner.solve();
+  info(1, verbose, "distance tables: ", planner.D->num_tables(), "\tmemory: ",
+       planner.D->get_memory_usage() / 1024, "KB");
+  return solution;
+}
+
+Solution solve_portfolio(const Instance& ins, const int verbose,
+                         const Deadline* deadline, const int seed,
+                         const int num_planners,
+                         const std::optional<int> threshold,
+                         const bool allow_following,
+                         const Precompute precompute, const int num_threads,
+                         const std::string& dist_cache_dir,
+                         const bool compress_dist_table,
+                         std::shared_ptr<DistTableMultiGoal> D)
+{
+  info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tpre-processing");
+  if (D == nullptr) D = std::make_shared<DistTableMultiGoal>(ins);
+  setup_dist_table(*D, ins, verbose, deadline, precompute, num_threads,
+                   dist_cache_dir, compress_dist_table);
+  D->concurrent = true;
+
+  const int K = num_planners > 0
+                    ? num_planners
+                    : std::max(1u, std::thread::hardware_concurrency());
+  std::atomic<bool> solved(false);
+  Solution solution;
+  int winner = -1;
+  std::vector<std::thread> threads;
+  for (int k = 0; k < K; ++k) {
+    threads.emplace_back([&, k]() {
+      auto MT = std::mt19937(seed + k);
+      auto planner = Planner(&ins, deadline, &MT, 0, threshold,
+                             allow_following && k % 2 == 0, D);
+      planner.cancel = &solved;
+      auto solution_k = planner.solve();
+      if (!solution_k.empty() && !solved.exchange(true)) {
+        solution = std::move(solution_k);
+        winner = k;
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+  D->concurrent = false;
+
+  info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\t",
+       solution.empty() ? "failed" : "solution found", "\tplanners:", K,
+       "\twinner:", winner);
+  info(1, verbose, "distance tables: ", D->num_tables(), "\tmemory: ",
+       D->get_memory_usage() / 1024, "KB");
+  return solution;
 }
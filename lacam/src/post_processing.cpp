@@ -2,9 +2,80 @@
 
 #include "../include/dist_table.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+// the first invalid transition found in solution
+struct Violation {
+  int t;  // timestep, -1 -> none
+  int i;  // agent
+  int j;  // another agent, -1 -> invalid move
+  const char* type;
+};
+
+// check transitions t-1 -> t for t in [t_from, t_to), in O(N) per timestep
+static Violation find_violation(const Instance& ins, const Solution& solution,
+                                size_t t_from, size_t t_to,
+                                const bool allow_following)
+{
+  const int N = ins.N;
+  auto occupied_prev = std::vector<int>(ins.G.size(), -1);
+  auto occupied_now = std::vector<int>(ins.G.size(), -1);
+
+  for (auto t = t_from; t < t_to; ++t) {
+    const auto& C_from = solution[t - 1];
+    const auto& C_to = solution[t];
+    for (int i = 0; i < N; ++i) occupied_prev[C_from[i]->id] = i;
+
+    auto violation = Violation{-1, -1, -1, nullptr};
+    for (int i = 0; i < N && violation.t < 0; ++i) {
+      auto v_i_from = C_from[i];
+      auto v_i_to = C_to[i];
+
+      // check connectivity
+      if (v_i_from != v_i_to &&
+          std::find(v_i_to->neighbor.begin(), v_i_to->neighbor.end(),
+                    v_i_from) == v_i_to->neighbor.end()) {
+        violation = Violation{(int)t, i, -1, "invalid move"};
+        break;
+      }
+
+      // vertex conflicts
+      auto& k = occupied_now[v_i_to->id];
+      if (k >= 0) {
+        violation = Violation{(int)t, k, i, "vertex conflict"};
+        break;
+      }
+      k = i;
+
+      const auto j = occupied_prev[v_i_to->id];
+      if (j < 0 || j == i) continue;
+      if (allow_following) {
+        // swap conflicts
+        if (C_to[j] == v_i_from) {
+          violation = Violation{(int)t, std::min(i, j), std::max(i, j),
+                                "swap conflict"};
+        }
+      } else {
+        // following conflicts
+        violation = Violation{(int)t, i, j, "following conflict"};
+      }
+    }
+
+    // clear occupancy
+    for (int i = 0; i < N; ++i) {
+      occupied_prev[C_from[i]->id] = -1;
+      occupied_now[C_to[i]->id] = -1;
+    }
+    if (violation.t >= 0) return violation;
+  }
+  return Violation{-1, -1, -1, nullptr};
+}
+
 bool is_feasible_solution(const Instance& ins, const Solution& solution,
                           const int verbose, const std::optional<int> threshold,
-                          const bool allow_following)
+                          const bool allow_following, int num_threads)
 {
   if (solution.empty()) return true;
 
@@ -23,43 +94,36 @@ bool is_feasible_solution(const Instance& ins, const Solution& solution,
     return false;
   }
 
-  for (size_t t = 1; t < solution.size(); ++t) {
-    for (size_t i = 0; i < ins.N; ++i) {
-      auto v_i_from = solution[t - 1][i];
-      auto v_i_to = solution[t][i];
-      // check connectivity
-      if (v_i_from != v_i_to &&
-          std::find(v_i_to->neighbor.begin(), v_i_to->neighbor.end(),
-                    v_i_from) == v_i_to->neighbor.end()) {
-        info(1, verbose, "invalid move");
-        return false;
-      }
-
-      // check conflicts
-      for (size_t j = i + 1; j < ins.N; ++j) {
-        auto v_j_from = solution[t - 1][j];
-        auto v_j_to = solution[t][j];
-        // vertex conflicts
-        if (v_j_to == v_i_to) {
-          info(1, verbose, "vertex conflict");
-          return false;
-        }
+  // split timesteps among threads, small solutions are checked serially
+  const size_t T = solution.size();
+  if (num_threads <= 0) {
+    num_threads = std::min((int)std::thread::hardware_concurrency(),
+                           (int)((T * ins.N) >> 16) + 1);
+  }
+  num_threads = std::max(1, std::min(num_threads, (int)(T - 1)));
+  auto violations = std::vector<Violation>(num_threads);
+  auto check = [&](int k) {
+    const auto t_from = 1 + (T - 1) * k / num_threads;
+    const auto t_to = 1 + (T - 1) * (k + 1) / num_threads;
+    violations[k] =
+        find_violation(ins, solution, t_from, t_to, allow_following);
+  };
+  std::vector<std::thread> threads;
+  for (int k = 1; k < num_threads; ++k) threads.emplace_back(check, k);
+  check(0);
+  for (auto& th : threads) th.join();
 
-        if (allow_following) {
-          // swap conflicts
-          if (v_j_to == v_i_from && v_j_from == v_i_to) {
-            info(1, verbose, "swap conflict");
-            return false;
-          }
-        } else {
-          // following conflicts
-          if (v_i_to == v_j_from || v_j_to == v_i_from) {
-            info(1, verbose, "following conflict");
-            return false;
-          }
-        }
-      }
+  // report the earliest one
+  for (auto& violation : violations) {
+    if (violation.t < 0) continue;
+    if (violation.j < 0) {
+      info(1, verbose, violation.type, " at timestep ", violation.t,
+           ": agent ", violation.i);
+    } else {
+      info(1, verbose, violation.type, " at timestep ", violation.t,
+           ": agents ", violation.i, " and ", violation.j);
     }
+    return false;
   }
 
   return true;
@@ -123,14 +187,19 @@ int get_sum_of_costs_lower_bound(const Instance& ins, DistTableMultiGoal& dist_t
 }
 
 void print_stats(const int verbose, const Instance& ins,
-                 const Solution& solution, const double comp_time_ms)
+                 const Solution& solution, const double comp_time_ms,
+                 DistTableMultiGoal* dist_table)
 {
   auto ceil = [](float x) { return std::ceil(x * 100) / 100; };
-  auto dist_table = DistTableMultiGoal(ins);
+  std::unique_ptr<DistTableMultiGoal> dist_table_local;
+  if (dist_table == nullptr) {
+    dist_table_local = std::make_unique<DistTableMultiGoal>(ins);
+    dist_table = dist_table_local.get();
+  }
   const auto makespan = get_makespan(solution);
-  const auto makespan_lb = get_makespan_lower_bound(ins, dist_table);
+  const auto makespan_lb = get_makespan_lower_bound(ins, *dist_table);
   const auto sum_of_costs = get_sum_of_costs(solution);
-  const auto sum_of_costs_lb = get_sum_of_costs_lower_bound(ins, dist_table);
+  const auto sum_of_costs_lb = get_sum_of_costs_lower_bound(ins, *dist_table);
   const auto sum_of_loss = get_sum_of_loss(solution);
   info(1, verbose, "solved: ", comp_time_ms, "ms", "\tmakespan: ", makespan,
        " (lb=", makespan_lb, ", ub=", ceil((float)makespan / makespan_lb), ")",
@@ -143,23 +212,53 @@ void print_stats(const int verbose, const Instance& ins,
 // for log of map_name
 static const std::regex r_map_name = std::regex(R"(.+/(.+))");
 
+static std::string get_map_recorded_name(const std::string& map_name)
+{
+  std::smatch results;
+  return (std::regex_match(map_name, results, r_map_name)) ? results[1].str()
+                                                           : map_name;
+}
+
+// paths part of logs for visualizer
+static void write_log_paths(std::ofstream& log, const Graph& G,
+                            const Config& starts, const Config& goals,
+                            const Solution& solution)
+{
+  auto get_x = [&](int k) { return G.get_x(k); };
+  auto get_y = [&](int k) { return G.get_y(k); };
+  log << "starts=";
+  for (auto v : starts) {
+    log << "(" << get_x(v->index) << "," << get_y(v->index) << "),";
+  }
+  log << "\ngoals=";
+  for (auto v : goals) {
+    log << "(" << get_x(v->index) << "," << get_y(v->index) << "),";
+  }
+  log << "\nsolution=\n";
+  for (size_t t = 0; t < solution.size(); ++t) {
+    log << t << ":";
+    for (auto v : solution[t]) {
+      log << "(" << get_x(v->index) << "," << get_y(v->index) << "),";
+    }
+    log << "\n";
+  }
+}
+
 void make_log(const Instance& ins, const Solution& solution,
               const std::string& output_name, const double comp_time_ms,
               const std::string& map_name, const int seed, const bool log_short,
-              const bool skip_post_processing)
+              const bool skip_post_processing, DistTableMultiGoal* dist_table)
 {
-  // map name
-  std::smatch results;
-  const auto map_recorded_name =
-      (std::regex_match(map_name, results, r_map_name)) ? results[1].str()
-                                                        : map_name;
+  const auto map_recorded_name = get_map_recorded_name(map_name);
 
   // for instance-specific values
-  auto dist_table = DistTableMultiGoal(ins);
+  std::unique_ptr<DistTableMultiGoal> dist_table_local;
+  if (dist_table == nullptr && !skip_post_processing) {
+    dist_table_local = std::make_unique<DistTableMultiGoal>(ins);
+    dist_table = dist_table_local.get();
+  }
 
   // log for visualizer
-  auto get_x = [&](int k) { return k % ins.G.width; };
-  auto get_y = [&](int k) { return k / ins.G.width; };
   std::ofstream log;
   log.open(output_name, std::ios::out);
   log << "agents=" << ins.N << "\n";
@@ -169,35 +268,278 @@ void make_log(const Instance& ins, const Solution& solution,
 
   if (!skip_post_processing) {
     log << "soc=" << get_sum_of_costs(solution) << "\n";
-    log << "soc_lb=" << get_sum_of_costs_lower_bound(ins, dist_table) << "\n";
+    log << "soc_lb=" << get_sum_of_costs_lower_bound(ins, *dist_table) << "\n";
     log << "makespan=" << get_makespan(solution) << "\n";
-    log << "makespan_lb=" << get_makespan_lower_bound(ins, dist_table) << "\n";
+    log << "makespan_lb=" << get_makespan_lower_bound(ins, *dist_table)
+        << "\n";
     log << "sum_of_loss=" << get_sum_of_loss(solution) << "\n";
-    log << "sum_of_loss_lb=" << get_sum_of_costs_lower_bound(ins, dist_table)
+    log << "sum_of_loss_lb=" << get_sum_of_costs_lower_bound(ins, *dist_table)
         << "\n";
   }
 
   log << "comp_time=" << comp_time_ms << "\n";
   log << "seed=" << seed << "\n";
   if (log_short) return;
-  log << "starts=";
-  for (size_t i = 0; i < ins.N; ++i) {
-    auto k = ins.starts[i]->index;
-    log << "(" << get_x(k) << "," << get_y(k) << "),";
+  write_log_paths(log, ins.G, ins.starts, ins.goals, solution);
+  log.close();
+}
+
+struct BinarySolutionHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t N;  // number of agents
+  uint32_t T;  // number of configurations
+  uint32_t width;
+  uint32_t height;
+  uint32_t keyframe_interval;
+  int32_t seed;
+  uint32_t reserved;
+  double comp_time_ms;
+};
+static constexpr char SOLUTION_MAGIC[8] = {'L', 'A', 'C', 'A',
+                                           'M', 'S', 'L', '\0'};
+static constexpr uint32_t SOLUTION_VERSION = 1;
+static constexpr uint32_t KEYFRAME_INTERVAL = 64;
+
+// move codes, same order as Graph::for_each_neighbor
+enum MoveCode : uint8_t { WAIT, LEFT, RIGHT, UP, DOWN, INVALID };
+
+static size_t get_move_bytes(size_t N) { return (3 * N + 7) / 8; }
+
+static uint8_t read_move(const uint8_t* buf, size_t i)
+{
+  const auto bit = 3 * i;
+  uint32_t word = buf[bit / 8];
+  if (bit % 8 > 5) word |= (uint32_t)buf[bit / 8 + 1] << 8;
+  return (word >> (bit % 8)) & 7;
+}
+
+static void write_move(uint8_t* buf, size_t i, uint8_t code)
+{
+  const auto bit = 3 * i;
+  buf[bit / 8] |= code << (bit % 8);
+  if (bit % 8 > 5) buf[bit / 8 + 1] |= code >> (8 - bit % 8);
+}
+
+static uint8_t get_move_code(int from, int to, int width)
+{
+  if (to == from) return WAIT;
+  if (to == from - 1 && from % width > 0) return LEFT;
+  if (to == from + 1 && to % width > 0) return RIGHT;
+  if (to == from + width) return UP;
+  if (to == from - width) return DOWN;
+  return INVALID;
+}
+
+// moves of one timestep, false if some code is broken or leaves the grid
+// same adjacency as get_move_code
+static bool apply_moves(const uint8_t* buf, int N, int width, int height,
+                        std::vector<uint32_t>& indexes)
+{
+  for (auto i = 0; i < N; ++i) {
+    const auto x = indexes[i] % width;
+    const auto y = indexes[i] / width;
+    switch (read_move(buf, i)) {
+      case WAIT:
+        break;
+      case LEFT:
+        if (x == 0) return false;
+        indexes[i] -= 1;
+        break;
+      case RIGHT:
+        if (x + 1 >= (uint32_t)width) return false;
+        indexes[i] += 1;
+        break;
+      case UP:
+        if (y + 1 >= (uint32_t)height) return false;
+        indexes[i] += width;
+        break;
+      case DOWN:
+        if (y == 0) return false;
+        indexes[i] -= width;
+        break;
+      default:
+        return false;
+    }
   }
-  log << "\ngoals=";
-  for (size_t i = 0; i < ins.N; ++i) {
-    auto k = ins.goals[i]->index;
-    log << "(" << get_x(k) << "," << get_y(k) << "),";
+  return true;
+}
+
+bool save_solution(const std::string& filename, const Instance& ins,
+                   const Solution& solution, const double comp_time_ms,
+                   const int seed)
+{
+  const auto N = ins.N;
+  const auto T = solution.size();
+  const int width = ins.G.width;
+
+  // full configurations, the starts are kept even without solution
+  std::vector<uint32_t> contents;
+  for (auto v : ins.goals) contents.push_back(v->index);
+  for (auto v : ins.starts) contents.push_back(v->index);
+  for (size_t t = KEYFRAME_INTERVAL; t < T; t += KEYFRAME_INTERVAL) {
+    for (auto v : solution[t]) contents.push_back(v->index);
   }
-  log << "\nsolution=\n";
-  for (size_t t = 0; t < solution.size(); ++t) {
-    log << t << ":";
-    auto C = solution[t];
-    for (auto v : C) {
-      log << "(" << get_x(v->index) << "," << get_y(v->index) << "),";
+
+  // moves between grid-adjacent cells only
+  const auto move_bytes = get_move_bytes(N);
+  auto moves = std::vector<uint8_t>(T > 0 ? (T - 1) * move_bytes : 0, 0);
+  for (size_t t = 1; t < T; ++t) {
+    auto buf = moves.data() + (t - 1) * move_bytes;
+    for (size_t i = 0; i < N; ++i) {
+      const auto code = get_move_code(solution[t - 1][i]->index,
+                                      solution[t][i]->index, width);
+      if (code == INVALID) {
+        info(0, 0, filename, ": agent ", i, " at timestep ", t,
+             " is not a grid move");
+        return false;
+      }
+      write_move(buf, i, code);
     }
-    log << "\n";
   }
+
+  BinarySolutionHeader header;
+  std::memcpy(header.magic, SOLUTION_MAGIC, sizeof(SOLUTION_MAGIC));
+  header.version = SOLUTION_VERSION;
+  header.N = N;
+  header.T = T;
+  header.width = ins.G.width;
+  header.height = ins.G.height;
+  header.keyframe_interval = KEYFRAME_INTERVAL;
+  header.seed = seed;
+  header.reserved = 0;
+  header.comp_time_ms = comp_time_ms;
+
+  std::ofstream file(filename, std::ios::binary);
+  if (!file) return false;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(contents.data()),
+             contents.size() * sizeof(uint32_t));
+  file.write(reinterpret_cast<const char*>(moves.data()), moves.size());
+  file.close();
+  return (bool)file;
+}
+
+SolutionReader::SolutionReader(const std::string& filename)
+    : file(filename),
+      is_valid(false),
+      N(0),
+      T(0),
+      width(0),
+      height(0),
+      keyframe_interval(1),
+      seed(0),
+      comp_time_ms(0),
+      goals(nullptr),
+      keyframes(nullptr),
+      moves(nullptr)
+{
+  if (!file.is_open) {
+    info(0, 0, filename, " is not found");
+    return;
+  }
+  const auto header = reinterpret_cast<const BinarySolutionHeader*>(file.data);
+  if (file.size < sizeof(BinarySolutionHeader) ||
+      std::memcmp(header->magic, SOLUTION_MAGIC, sizeof(SOLUTION_MAGIC)) != 0 ||
+      header->version != SOLUTION_VERSION || header->keyframe_interval == 0 ||
+      header->width == 0 || header->height == 0) {
+    info(0, 0, filename, ": not a binary solution");
+    return;
+  }
+  const size_t num_keyframes =
+      header->T == 0 ? 1 : (header->T - 1) / header->keyframe_interval + 1;
+  const size_t move_bytes =
+      header->T == 0 ? 0 : (header->T - 1) * get_move_bytes(header->N);
+  if (file.size != sizeof(BinarySolutionHeader) +
+                       (num_keyframes + 1) * header->N * sizeof(uint32_t) +
+                       move_bytes) {
+    info(0, 0, filename, ": truncated binary solution");
+    return;
+  }
+  N = header->N;
+  T = header->T;
+  width = header->width;
+  height = header->height;
+  keyframe_interval = header->keyframe_interval;
+  seed = header->seed;
+  comp_time_ms = header->comp_time_ms;
+  goals = reinterpret_cast<const uint32_t*>(file.data +
+                                            sizeof(BinarySolutionHeader));
+  keyframes = goals + N;
+  moves = reinterpret_cast<const uint8_t*>(keyframes + num_keyframes * N);
+  is_valid = true;
+}
+
+bool SolutionReader::get(int t, std::vector<uint32_t>& indexes) const
+{
+  // the starts are available even without solution
+  if (!is_valid || t < 0 || t >= std::max(T, 1)) return false;
+  const auto k = t / keyframe_interval;
+  indexes.assign(keyframes + k * N, keyframes + (k + 1) * N);
+  for (auto s = k * keyframe_interval + 1; s <= t; ++s) {
+    const auto buf = moves + (s - 1) * get_move_bytes(N);
+    if (!apply_moves(buf, N, width, height, indexes)) return false;
+  }
+  return true;
+}
+
+Solution SolutionReader::load(const Graph& G) const
+{
+  auto solution = Solution();
+  std::vector<uint32_t> indexes;
+  for (auto t = 0; t < T; ++t) {
+    // sequential reading, moves are applied to the previous configuration
+    const auto ok = t % keyframe_interval == 0
+                        ? get(t, indexes)
+                        : apply_moves(moves + (t - 1) * get_move_bytes(N), N,
+                                      width, height, indexes);
+    if (!ok) return Solution();
+    auto C = Config();
+    for (auto k : indexes) {
+      auto v = G.get_vertex_by_index(k);
+      if (v == nullptr) return Solution();
+      C.push_back(v, 0);
+    }
+    solution.push_back(C);
+  }
+  return solution;
+}
+
+bool make_log_from_binary(const std::string& solution_filename,
+                          const Graph& G, const std::string& output_name,
+                          const std::string& map_name)
+{
+  const auto reader = SolutionReader(solution_filename);
+  if (!reader.is_valid) return false;
+  if (reader.width != G.width || reader.height != G.height) {
+    info(0, 0, solution_filename, ": map size mismatch");
+    return false;
+  }
+  const auto solution = reader.load(G);
+  if ((int)solution.size() != reader.T) {
+    info(0, 0, solution_filename, ": broken moves");
+    return false;
+  }
+  auto starts = Config();
+  auto goals = Config();
+  for (auto i = 0; i < reader.N; ++i) {
+    starts.push_back(G.get_vertex_by_index(reader.keyframes[i]), 0);
+    goals.push_back(G.get_vertex_by_index(reader.goals[i]), 0);
+    if (starts[i] == nullptr || goals[i] == nullptr) {
+      info(0, 0, solution_filename, ": vertices not in the map");
+      return false;
+    }
+  }
+
+  std::ofstream log;
+  log.open(output_name, std::ios::out);
+  log << "agents=" << reader.N << "\n";
+  log << "map_file=" << get_map_recorded_name(map_name) << "\n";
+  log << "solver=planner\n";
+  log << "solved=" << !solution.empty() << "\n";
+  log << "comp_time=" << reader.comp_time_ms << "\n";
+  log << "seed=" << reader.seed << "\n";
+  write_log_paths(log, G, starts, goals, solution);
   log.close();
+  return (bool)log;
 }
@@ -0,0 +1,53 @@
+#include "../include/session.hpp"
+
+Session::Session(Instance* _ins, int _verbose, std::mt19937* _MT,
+                 bool _allow_following)
+    : ins(_ins),
+      verbose(_verbose),
+      MT(_MT),
+      allow_following(_allow_following),
+      D(std::make_shared<DistTableMultiGoal>(ins)),
+      planner(nullptr),
+      num_rounds(0)
+{
+}
+
+void Session::append_goals(int i, const std::vector<Vertex*>& goals)
+{
+  if (goals.empty()) return;
+  auto& goal_sequence = ins->goal_sequences[i];
+  goal_sequence.insert(goal_sequence.end(), goals.begin(), goals.end());
+  ins->goals[i] = goal_sequence.back();
+  ins->goals.goal_indices[i] = goal_sequence.size() - 1;
+  D->append_goals(i, goals);
+}
+
+Solution Session::solve(const Config& C, const std::optional<int> num_goals,
+                        const Deadline* deadline, const Solution& hint)
+{
+  num_rounds += 1;
+  ins->starts = C;
+
+  // tables of passed goals are released unless other agents need them
+  for (size_t i = 0; i < ins->N; ++i) D->retire_goals(i, C.goal_indices[i]);
+
+  // goal indices may outgrow the encoding of search nodes
+  const auto goal_width = planner == nullptr ? 0 : planner->layout.goal_width;
+  if (goal_width == 0 ||
+      (goal_width < 4 && (ins->get_max_goal_index() >> (8 * goal_width)) > 0)) {
+    planner = std::make_unique<Planner>(ins, deadline, MT, verbose,
+                                        std::nullopt, allow_following, D);
+  }
+  planner->deadline = deadline;
+  planner->hint = hint;
+  planner->threshold = std::nullopt;
+  if (num_goals.has_value()) {
+    int reached = 0;
+    for (auto k : C.goal_indices) reached += k;
+    planner->threshold = reached + num_goals.value();
+  }
+
+  info(1, verbose, "round:", num_rounds, "\ttotal goals:",
+       ins->get_total_goals());
+  return planner->solve();
+}
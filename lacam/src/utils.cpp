@@ -1,5 +1,12 @@
 #include "../include/utils.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
 void info(const int level, const int verbose) { std::cout << std::endl; }
 
 Deadline::Deadline(double _time_limit_ms)
@@ -44,8 +51,64 @@ float get_random_float(std::mt19937* MT, float from, float to)
   return r(*MT);
 }
 
-uint hash_two_ints(uint a, uint b)
+uint64_t mix_hash(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+MappedFile::MappedFile(const std::string& filename)
+    : data(nullptr), size(0), is_open(false)
+{
+  auto fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    size = st.st_size;
+    if (size == 0) {
+      is_open = true;
+    } else {
+      auto addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        data = static_cast<const char*>(addr);
+        is_open = true;
+        madvise(addr, size, MADV_SEQUENTIAL);
+      }
+    }
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (data != nullptr) munmap(const_cast<char*>(data), size);
+}
+
+LineReader::LineReader(const char* data, size_t size)
+    : p(data), end(data + size), line_number(0)
+{
+}
+
+bool LineReader::next(std::string_view& line)
+{
+  if (p == nullptr || p >= end) return false;
+  auto q = static_cast<const char*>(std::memchr(p, '\n', end - p));
+  if (q == nullptr) q = end;
+  line = std::string_view(p, q - p);
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+  p = q + 1;
+  ++line_number;
+  return true;
+}
+
+bool parse_uint(std::string_view s, int& x)
 {
-  a ^= b + 0x9e3779b9 + (a << 6) + (a >> 2);
-  return a;
+  if (s.empty() || s.size() > 9) return false;
+  x = 0;
+  for (auto c : s) {
+    if (c < '0' || c > '9') return false;
+    x = x * 10 + (c - '0');
+  }
+  return true;
 }
@@ -22,6 +22,10 @@ int main(int argc, char* argv[])
   program.add_argument("-o", "--output")
       .help("output file")
       .default_value(std::string("./build/result.txt"));
+  program.add_argument("--binary_output")
+      .help(
+          "binary solution file, c.f., convert_solution, empty -> unused")
+      .default_value(std::string(""));
   program.add_argument("-l", "--log_short")
       .default_value(false)
       .implicit_value(true);
@@ -34,6 +38,41 @@ int main(int argc, char* argv[])
       .help("allow following conflicts")
       .default_value(false)
       .implicit_value(true);
+  program.add_argument("--precompute")
+      .help(
+          "eager computation of distance tables before search: none, first "
+          "(first goal of every agent), or all")
+      .default_value(std::string("none"));
+  program.add_argument("--threads")
+      .help("number of threads for precomputation, 0 -> all cores")
+      .default_value(std::string("0"));
+  program.add_argument("--dist_cache")
+      .help("directory of the on-disk distance table cache, empty -> unused")
+      .default_value(std::string(""));
+  program.add_argument("--compress_dist_table")
+      .help("compress complete distance tables to save memory")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--portfolio")
+      .help(
+          "number of planners with different seeds on threads, the first "
+          "solution wins, 0 -> all cores, 1 -> single planner")
+      .default_value(std::string("1"));
+  program.add_argument("--search_threads")
+      .help(
+          "number of workers of the high-level search sharing the explored "
+          "list, 0 -> all cores, 1 -> sequential")
+      .default_value(std::string("1"));
+  program.add_argument("--anytime")
+      .help(
+          "keep refining the sum of loss w.r.t. goal sequences until the time "
+          "limit, sequential search only")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--implicit_graph")
+      .help("keep the grid as an obstacle bitmap, for very large maps")
+      .default_value(false)
+      .implicit_value(true);
   program.add_argument("--skip_post_processing")
       .help(
           "Skip potentially time-consuming post processing such as calculating "
@@ -58,6 +97,7 @@ int main(int argc, char* argv[])
   auto MT = std::mt19937(seed);
   const auto map_name = program.get<std::string>("map");
   const auto output_name = program.get<std::string>("output");
+  const auto binary_output_name = program.get<std::string>("binary_output");
   const auto log_short = program.get<bool>("log_short");
   const auto N = std::stoi(program.get<std::string>("num"));
   auto user_threshold = std::stoi(program.get<std::string>("threshold"));
@@ -70,14 +110,51 @@ int main(int argc, char* argv[])
   }
   const auto allow_following = program.get<bool>("allow_following");
   const auto skip_post_processing = program.get<bool>("skip_post_processing");
-  const auto ins = scen_name.size() > 0 ? Instance(scen_name, map_name, N)
-                                        : Instance(map_name, &MT, N);
+  const auto precompute_name = program.get<std::string>("precompute");
+  Precompute precompute = Precompute::NONE;
+  if (precompute_name == "first") {
+    precompute = Precompute::FIRST_GOALS;
+  } else if (precompute_name == "all") {
+    precompute = Precompute::ALL_GOALS;
+  } else if (precompute_name != "none") {
+    info(0, verbose, "invalid precompute option");
+    return 1;
+  }
+  const auto num_threads = std::stoi(program.get<std::string>("threads"));
+  const auto dist_cache_dir = program.get<std::string>("dist_cache");
+  const auto compress_dist_table = program.get<bool>("compress_dist_table");
+  const auto num_planners = std::stoi(program.get<std::string>("portfolio"));
+  const auto num_workers =
+      std::stoi(program.get<std::string>("search_threads"));
+  const auto anytime = program.get<bool>("anytime");
+  if (num_planners != 1 && (anytime || num_workers != 1)) {
+    info(0, verbose,
+         "portfolio cannot be combined with anytime or search_threads");
+    return 1;
+  }
+  if (anytime && num_workers != 1) {
+    info(0, verbose,
+         "anytime runs the sequential search, set search_threads to 1");
+    return 1;
+  }
+  const auto implicit_graph = program.get<bool>("implicit_graph");
+  const auto ins = scen_name.size() > 0
+                       ? Instance(scen_name, map_name, N, implicit_graph)
+                       : Instance(map_name, &MT, N, implicit_graph);
   if (!ins.is_valid(1)) return 1;
 
-  // solve
+  // solve, the distance table is reused in post processing
   const auto deadline = Deadline(time_limit_sec * 1000);
+  auto dist_table = std::make_shared<DistTableMultiGoal>(ins);
   const auto solution =
-      solve(ins, verbose - 1, &deadline, &MT, threshold, allow_following);
+      num_planners == 1
+          ? solve(ins, verbose - 1, &deadline, &MT, threshold, allow_following,
+                  precompute, num_threads, dist_cache_dir, compress_dist_table,
+                  dist_table, num_workers, anytime)
+          : solve_portfolio(ins, verbose - 1, &deadline, seed, num_planners,
+                            threshold, allow_following, precompute,
+                            num_threads, dist_cache_dir, compress_dist_table,
+                            dist_table);
   const auto comp_time_ms = deadline.elapsed_ms();
 
   // failure
@@ -91,8 +168,15 @@ int main(int argc, char* argv[])
   }
 
   // post processing
-  if (!skip_post_processing) print_stats(verbose, ins, solution, comp_time_ms);
+  if (!skip_post_processing) {
+    print_stats(verbose, ins, solution, comp_time_ms, dist_table.get());
+  }
   make_log(ins, solution, output_name, comp_time_ms, map_name, seed, log_short,
-           skip_post_processing);
+           skip_post_processing, dist_table.get());
+  if (!binary_output_name.empty() &&
+      !save_solution(binary_output_name, ins, solution, comp_time_ms, seed)) {
+    info(0, verbose, "failed to write ", binary_output_name);
+    return 1;
+  }
   return 0;
 }
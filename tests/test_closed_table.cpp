@@ -0,0 +1,77 @@
+#include <lacam.hpp>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+TEST(ClosedTable, find_and_insert)
+{
+  const auto map_filename = "./assets/empty-8-8.map";
+  const auto ins = Instance(map_filename, {0, 1}, {2, 3});
+  auto D = DistTableMultiGoal(ins);
+  auto layout = ConfigLayout(ins.G, ins.N, ins.get_max_goal_index());
+  auto CLOSED = ClosedTable(&layout, 2);
+
+  // insert many configurations to trigger resizing
+  std::vector<Node*> nodes;
+  for (int k = 0; k < 64; ++k) {
+    auto C = Config({ins.G.U[k], ins.G.U[(k + 1) % 64]});
+    nodes.push_back(new Node(C, ConfigHasher()(C), layout, D));
+    ASSERT_EQ(CLOSED.find(C, ConfigHasher()(C)), nullptr);
+    CLOSED.insert(nodes.back(), ConfigHasher()(C));
+  }
+  ASSERT_EQ(CLOSED.size(), 64);
+  ASSERT_LE(CLOSED.load_factor(), 0.5);
+
+  for (int k = 0; k < 64; ++k) {
+    auto C = Config({ins.G.U[k], ins.G.U[(k + 1) % 64]});
+    ASSERT_EQ(CLOSED.find(C, ConfigHasher()(C)), nodes[k]);
+  }
+  auto C = Config({ins.G.U[0], ins.G.U[1]}, {0, 1});
+  ASSERT_EQ(CLOSED.find(C, ConfigHasher()(C)), nullptr);
+  ASSERT_GE(CLOSED.average_probe_length(), 1);
+
+  CLOSED.clear();
+  ASSERT_EQ(CLOSED.size(), 0);
+  for (auto S : nodes) delete S;
+}
+
+TEST(ConcurrentClosedTable, find_or_insert)
+{
+  const auto map_filename = "./assets/empty-8-8.map";
+  const auto ins = Instance(map_filename, {0, 1}, {2, 3});
+  auto D = DistTableMultiGoal(ins);
+  D.concurrent = true;
+  auto layout = ConfigLayout(ins.G, ins.N, ins.get_max_goal_index());
+  auto CLOSED = ConcurrentClosedTable(&layout, 2);
+
+  // the same configurations from many threads, one node is stored for each
+  const int num_threads = 4;
+  std::vector<std::vector<Node*>> created(num_threads);
+  std::vector<std::vector<Node*>> stored(num_threads);
+  std::vector<int> num_inserted(num_threads, 0);
+  std::vector<std::thread> threads;
+  for (int j = 0; j < num_threads; ++j) {
+    threads.emplace_back([&, j]() {
+      for (int k = 0; k < 64; ++k) {
+        auto C = Config({ins.G.U[k], ins.G.U[(k + 1) % 64]});
+        const auto hash = ConfigHasher()(C);
+        auto [S, inserted] = CLOSED.find_or_insert(C, hash, [&]() {
+          created[j].push_back(new Node(C, hash, layout, D));
+          return created[j].back();
+        });
+        stored[j].push_back(S);
+        num_inserted[j] += inserted;
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+
+  ASSERT_EQ(CLOSED.size(), 64);
+  ASSERT_EQ(std::accumulate(num_inserted.begin(), num_inserted.end(), 0), 64);
+  for (int j = 1; j < num_threads; ++j) ASSERT_EQ(stored[j], stored[0]);
+
+  CLOSED.clear();
+  for (auto& nodes : created) {
+    for (auto S : nodes) delete S;
+  }
+}
@@ -1,3 +1,6 @@
+#include <filesystem>
+#include <fstream>
+#include <thread>
 #include <lacam.hpp>
 
 #include "gtest/gtest.h"
@@ -12,3 +15,199 @@ TEST(dist_table, init)
   ASSERT_EQ(dist_table.get(0, 0, ins.goals[0]), 0);
   ASSERT_EQ(dist_table.get(0, 0, ins.starts[0]), 16);
 }
+
+TEST(dist_table, shared_goals)
+{
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins =
+      Instance(map_filename, {0, 1, 2}, {{1023, 31}, {31}, {1023, 0}});
+  auto dist_table = DistTableMultiGoal(ins);
+
+  ASSERT_EQ(dist_table.num_tables(), 3);
+  ASSERT_EQ(dist_table.table_ids[0][0], dist_table.table_ids[2][0]);
+  ASSERT_EQ(dist_table.table_ids[0][1], dist_table.table_ids[1][0]);
+  ASSERT_EQ(dist_table.get(0, 1, ins.G.U[31]), 0);
+  ASSERT_EQ(dist_table.get(1, 0, ins.G.U[0]),
+            dist_table.get(0, 1, ins.G.U[0]));
+}
+
+TEST(dist_table, append_and_retire_goals)
+{
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(map_filename, {0, 1}, {{1023, 31}, {31}});
+  auto dist_table = DistTableMultiGoal(ins);
+  ASSERT_EQ(dist_table.num_tables(), 2);
+  dist_table.get(0, 0, ins.G.U[0]);
+  const auto memory_usage = dist_table.get_memory_usage();
+
+  // the table of 1023 is released, the one of 31 is still used by agent 1
+  dist_table.retire_goals(0, 1);
+  ASSERT_EQ(dist_table.table_ids[0][0], -1);
+  ASSERT_EQ(dist_table.num_tables(), 1);
+  ASSERT_LT(dist_table.get_memory_usage(), memory_usage);
+  ASSERT_EQ(dist_table.get(0, 1, ins.G.U[31]), 0);
+  ASSERT_EQ(dist_table.get(0, 0, ins.G.U[31]), 0);  // skip retired ones
+  ASSERT_EQ(get_makespan_lower_bound(ins, dist_table),
+            std::max(dist_table.get(0, 1, ins.starts[0]),
+                     dist_table.get(1, 0, ins.starts[1])));
+  ASSERT_EQ(get_sum_of_costs_lower_bound(ins, dist_table),
+            dist_table.get(0, 1, ins.starts[0]) +
+                dist_table.get(1, 0, ins.starts[1]));
+
+  // the released slot is reused by a new goal
+  dist_table.append_goals(1, {ins.G.U[0]});
+  ASSERT_EQ(dist_table.num_tables(), 2);
+  ASSERT_EQ(dist_table.table.size(), 2);
+  const auto ins_ref =
+      Instance(map_filename, std::vector<int>{1}, std::vector<int>{0});
+  auto dist_table_ref = DistTableMultiGoal(ins_ref);
+  ASSERT_EQ(dist_table.get(1, 1, ins.G.U[1023]->id),
+            dist_table_ref.get(0, 0, ins_ref.G.U[1023]->id));
+
+  // the last goal is kept even if reached
+  dist_table.retire_goals(0, 2);
+  ASSERT_EQ(dist_table.get(0, 2, ins.G.U[31]), 0);
+  ASSERT_EQ(dist_table.num_tables(), 2);
+}
+
+TEST(dist_table, precompute)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 20);
+  auto dist_table_lazy = DistTableMultiGoal(ins);
+  auto dist_table = DistTableMultiGoal(ins);
+  dist_table.precompute(Precompute::FIRST_GOALS, 4);
+
+  for (size_t i = 0; i < ins.N; ++i) {
+    ASSERT_TRUE(dist_table.OPEN[dist_table.table_ids[i][0]].empty());
+    for (auto v : ins.G.V) {
+      ASSERT_EQ(dist_table.get(i, 0, v), dist_table_lazy.get(i, 0, v));
+    }
+  }
+}
+
+TEST(dist_table, cache)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 5);
+  const auto dir = std::filesystem::temp_directory_path() / "lacam_test_cache";
+  std::filesystem::remove_all(dir);
+
+  // write back complete tables
+  auto dist_table = DistTableMultiGoal(ins);
+  dist_table.use_cache(dir, ins.G);
+  dist_table.precompute(Precompute::ALL_GOALS, 1);
+  for (auto g : dist_table.goals) {
+    const auto filename = dist_table.cache->get_filename(g->id);
+    ASSERT_TRUE(std::filesystem::exists(filename));
+  }
+
+  // load them
+  auto dist_table_cached = DistTableMultiGoal(ins);
+  dist_table_cached.use_cache(dir, ins.G);
+  for (size_t i = 0; i < ins.N; ++i) {
+    const auto id = dist_table_cached.table_ids[i][0];
+    ASSERT_TRUE(dist_table_cached.OPEN[id].empty());
+    for (auto v : ins.G.V) {
+      ASSERT_EQ(dist_table_cached.get(i, 0, v), dist_table.get(i, 0, v));
+    }
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(dist_table, compress)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 5);
+  auto dist_table_plain = DistTableMultiGoal(ins);
+  auto dist_table = DistTableMultiGoal(ins);
+  ASSERT_EQ(dist_table.width, 2);
+  dist_table.compress_finished = true;
+  dist_table.precompute(Precompute::ALL_GOALS, 1);
+
+  ASSERT_LT(dist_table.get_memory_usage(),
+            dist_table_plain.get_memory_usage());
+  for (size_t i = 0; i < ins.N; ++i) {
+    ASSERT_EQ(dist_table.storage[dist_table.table_ids[i][0]],
+              DistTableMultiGoal::Storage::BLOCK);
+    for (auto v : ins.G.V) {
+      ASSERT_EQ(dist_table.get(i, 0, v), dist_table_plain.get(i, 0, v));
+    }
+  }
+}
+
+// open grid or one serpentine corridor, with more than UINT16_MAX vertices
+static std::string write_large_map(const std::string& name, bool corridor)
+{
+  const int size = 400;
+  const auto filename =
+      (std::filesystem::temp_directory_path() / name).string();
+  std::ofstream file(filename);
+  file << "type octile\nheight " << size << "\nwidth " << size << "\nmap\n";
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const auto gate = (y % 4 == 1) ? size - 1 : 0;
+      file << (!corridor || y % 2 == 0 || x == gate ? '.' : '@');
+    }
+    file << "\n";
+  }
+  return filename;
+}
+
+TEST(dist_table, width)
+{
+  // short distances fit in uint16 though |V| does not
+  const auto grid_filename = write_large_map("lacam_test_grid.map", false);
+  const auto ins_grid = Instance(grid_filename, std::vector<int>{0},
+                                 std::vector<int>{400 * 400 - 1});
+  ASSERT_GT(ins_grid.G.size(), UINT16_MAX);
+  auto dist_table_grid = DistTableMultiGoal(ins_grid);
+  ASSERT_EQ(dist_table_grid.width, 2);
+  ASSERT_EQ(dist_table_grid.get(0, 0, ins_grid.starts[0]), 2 * 399);
+
+  // long corridor
+  const auto corridor_filename =
+      write_large_map("lacam_test_corridor.map", true);
+  const auto ins_corridor = Instance(corridor_filename, std::vector<int>{0},
+                                     std::vector<int>{399 * 400});
+  ASSERT_GT(ins_corridor.G.size() - 1, UINT16_MAX);
+  auto dist_table_corridor = DistTableMultiGoal(ins_corridor);
+  ASSERT_EQ(dist_table_corridor.width, 4);
+  ASSERT_EQ(dist_table_corridor.get(0, 0, ins_corridor.starts[0]),
+            ins_corridor.G.size() - 1);
+
+  std::filesystem::remove(grid_filename);
+  std::filesystem::remove(corridor_filename);
+}
+
+TEST(dist_table, concurrent)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 20);
+
+  auto dist_table = DistTableMultiGoal(ins);
+  dist_table.precompute(Precompute::ALL_GOALS, 1);
+
+  // lazy filling from many threads at once
+  auto dist_table_shared = DistTableMultiGoal(ins);
+  dist_table_shared.concurrent = true;
+  std::atomic<int> num_errors(0);
+  auto worker = [&](int seed) {
+    auto MT = std::mt19937(seed);
+    for (int k = 0; k < 2000; ++k) {
+      const int i = MT() % ins.N;
+      const int v_id = MT() % ins.G.size();
+      if (dist_table_shared.get(i, 0, v_id) != dist_table.get(i, 0, v_id)) {
+        ++num_errors;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int seed = 0; seed < 4; ++seed) threads.emplace_back(worker, seed);
+  for (auto& th : threads) th.join();
+  ASSERT_EQ(num_errors, 0);
+}
@@ -1,3 +1,4 @@
+#include <filesystem>
 #include <lacam.hpp>
 
 #include "gtest/gtest.h"
@@ -13,3 +14,198 @@ TEST(Graph, load_graph)
   ASSERT_EQ(G.width, 32);
   ASSERT_EQ(G.height, 32);
 }
+
+TEST(Graph, config_hash)
+{
+  const std::string filename = "./assets/random-32-32-10.map";
+  auto G = Graph(filename);
+  auto hasher = ConfigHasher();
+
+  auto C1 = Config({G.V[0], G.V[1], G.V[2]}, {0, 0, 1});
+  auto C2 = Config({G.V[0], G.V[3], G.V[2]}, {0, 1, 1});
+  auto C3 = Config({G.V[1], G.V[0], G.V[2]}, {0, 0, 1});
+  ASSERT_EQ(hasher(C2, C1, hasher(C1)), hasher(C2));
+  ASSERT_EQ(hasher(C1, C2, hasher(C2)), hasher(C1));
+  ASSERT_EQ(hasher(C2, C1, hasher(C1), {1}, {1}), hasher(C2));
+  ASSERT_EQ(hasher(C3, C1, hasher(C1), {0, 1}, {}), hasher(C3));
+  ASSERT_NE(hasher(C1), hasher(C2));
+  ASSERT_NE(hasher(C1), hasher(C3));
+}
+
+TEST(Graph, config_layout)
+{
+  const std::string filename = "./assets/random-32-32-10.map";
+  auto G = Graph(filename);
+
+  auto layout = ConfigLayout(G, 3, 300);
+  ASSERT_EQ(layout.v_width, 2);
+  ASSERT_EQ(layout.goal_width, 2);
+  ASSERT_EQ(layout.bytes(), 12);
+
+  auto C = Config({G.V[921], G.V[1], G.V[2]}, {0, 300, 1});
+  auto buf = std::vector<uint8_t>(layout.bytes());
+  layout.encode(C, buf.data());
+  ASSERT_EQ(layout.get_vertex(buf.data(), 0), G.V[921]);
+  ASSERT_EQ(layout.get_goal_index(buf.data(), 1), 300);
+  ASSERT_TRUE(layout.equals(buf.data(), C));
+
+  auto C_decoded = Config();
+  layout.decode(buf.data(), C_decoded);
+  ASSERT_EQ(C_decoded, C);
+  C_decoded.goal_indices[2] = 0;
+  ASSERT_FALSE(layout.equals(buf.data(), C_decoded));
+}
+
+TEST(Graph, packed_config)
+{
+  const std::string filename = "./assets/random-32-32-10.map";
+  auto G = Graph(filename);
+  const int N = 8;
+  auto layout = ConfigLayout(G, N, 1, 2);
+
+  auto C0 = Config(N, G.V[0]);
+  for (int i = 0; i < N; ++i) C0[i] = G.V[i];
+  auto C1 = C0;
+  C1[3] = G.V[100];
+  auto C2 = C1;
+  C2.goal_indices[5] = 1;
+  auto C3 = C2;
+  C3[0] = G.V[200];
+
+  auto P0 = layout.pack(C0);
+  auto P1 = layout.pack(C1, &P0, &C0);
+  auto P2 = layout.pack(C2, &P1, &C1);
+  auto P3 = layout.pack(C3, &P2, &C2);
+  ASSERT_EQ(P0.base, nullptr);
+  ASSERT_EQ(P1.num_diffs, 1);
+  ASSERT_EQ(P2.depth, 2);
+  ASSERT_LT(layout.bytes(P2), layout.bytes(P0));
+  ASSERT_EQ(P3.base, nullptr);  // snapshot by interval
+
+  auto C = Config();
+  layout.unpack(P2, C);
+  ASSERT_EQ(C, C2);
+  layout.unpack(P3, C);
+  ASSERT_EQ(C, C3);
+
+  // resume from a known configuration
+  layout.unpack(P1, C);
+  layout.unpack(P2, C, &P1);
+  ASSERT_EQ(C, C2);
+
+  auto buf = Config();
+  ASSERT_TRUE(layout.equals(P2, C2, buf));
+  ASSERT_FALSE(layout.equals(P2, C1, buf));
+}
+
+TEST(Graph, parse_map)
+{
+  const auto filename =
+      (std::filesystem::temp_directory_path() / "lacam_test.map").string();
+  auto write = [&](const std::string& content) {
+    std::ofstream file(filename, std::ios::binary);
+    file << content;
+  };
+
+  // CRLF and tabs as separators
+  write("type octile\r\nheight\t2\r\nwidth 3\r\nmap\r\n.@.\r\n...\r\n");
+  auto G = Graph(filename);
+  ASSERT_EQ(G.width, 3);
+  ASSERT_EQ(G.height, 2);
+  ASSERT_EQ(G.size(), 5);
+  ASSERT_EQ(G.U[1], nullptr);
+
+  // malformed files result in empty graphs
+  write("height 2\nwidth 3\nmap\n...\n");  // too few rows
+  ASSERT_EQ(Graph(filename).size(), 0);
+  write("height 2\nwidth 3\nmap\n...\n..\n");  // too short row
+  ASSERT_EQ(Graph(filename).size(), 0);
+  write("height 2\nwidth 3\n...\n...\n");  // no map line
+  ASSERT_EQ(Graph(filename).size(), 0);
+
+  std::filesystem::remove(filename);
+}
+
+TEST(Graph, implicit_grid)
+{
+  const std::string filename = "./assets/random-32-32-10.map";
+  auto G = Graph(filename);
+  auto G_implicit = Graph(filename, true);
+  ASSERT_TRUE(G_implicit.V.empty());
+  ASSERT_EQ(G_implicit.num_created_blocks(), 0);
+  ASSERT_EQ(G_implicit.size(), G.size());
+  ASSERT_EQ(G_implicit.get_hash(), G.get_hash());
+
+  for (int index = 0; index < G.width * G.height; ++index) {
+    ASSERT_EQ(G_implicit.get_id(index), G.get_id(index));
+  }
+
+  // vertices are created on demand
+  auto v = G_implicit.get_vertex(300);
+  ASSERT_EQ(G_implicit.num_created_blocks(), 1);
+  ASSERT_EQ(v->id, 300);
+  ASSERT_EQ(v->index, G.V[300]->index);
+  ASSERT_EQ(G_implicit.get_vertex(300), v);
+  ASSERT_EQ(G_implicit.get_vertex_by_index(v->index), v);
+  for (int id = 0; id < G.size(); ++id) {
+    auto u = G_implicit.get_vertex(id);
+    ASSERT_EQ(u->index, G.V[id]->index);
+    ASSERT_EQ(u->neighbor.size(), G.V[id]->neighbor.size());
+    for (size_t k = 0; k < u->neighbor.size(); ++k) {
+      ASSERT_EQ(u->neighbor[k]->id, G.V[id]->neighbor[k]->id);
+    }
+  }
+}
+
+TEST(Graph, binary_graph)
+{
+  const std::string filename = "./assets/random-32-32-10.map";
+  const auto binary_filename =
+      (std::filesystem::temp_directory_path() / "lacam_test.graph").string();
+  auto G = Graph(filename);
+  ASSERT_TRUE(G.save_binary(binary_filename));
+
+  auto G_binary = Graph(binary_filename);
+  ASSERT_EQ(G_binary.storage, Graph::Storage::MAPPED);
+  ASSERT_EQ(G_binary.width, G.width);
+  ASSERT_EQ(G_binary.height, G.height);
+  ASSERT_EQ(G_binary.size(), G.size());
+  ASSERT_EQ(G_binary.get_hash(), G.get_hash());
+  ASSERT_EQ(G_binary.num_created_blocks(), 0);
+  for (int index = 0; index < G.width * G.height; ++index) {
+    ASSERT_EQ(G_binary.get_id(index), G.get_id(index));
+  }
+  for (int id = 0; id < G.size(); ++id) {
+    auto u = G_binary.get_vertex(id);
+    ASSERT_EQ(u->index, G.V[id]->index);
+    ASSERT_EQ(u->neighbor.size(), G.V[id]->neighbor.size());
+    for (size_t k = 0; k < u->neighbor.size(); ++k) {
+      ASSERT_EQ(u->neighbor[k]->id, G.V[id]->neighbor[k]->id);
+    }
+  }
+
+  // corrupted files are rejected
+  {
+    std::fstream file(binary_filename,
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-1, std::ios::end);
+    file.put(0x7f);
+  }
+  ASSERT_EQ(Graph(binary_filename).size(), 0);
+  std::filesystem::remove(binary_filename);
+}
+
+TEST(Graph, roadmap)
+{
+  const std::string filename = "./tests/assets/star.roadmap";
+  auto G = Graph(filename);
+  ASSERT_EQ(G.size(), 13);
+  ASSERT_EQ(G.max_degree, 6);
+  ASSERT_EQ(G.V[0]->neighbor.size(), 6);
+  ASSERT_EQ(G.V[0]->neighbor[5]->id, 6);
+  ASSERT_EQ(G.V[7]->neighbor.size(), 1);
+  ASSERT_EQ(G.V[7]->neighbor[0]->id, 1);
+  ASSERT_EQ(G.get_vertex_by_index(12), G.V[12]);
+  ASSERT_EQ(G.get_x(G.V[8]->index), 5);
+  ASSERT_EQ(G.get_y(G.V[8]->index), 3);
+}
@@ -1,3 +1,4 @@
+#include <filesystem>
 #include <lacam.hpp>
 
 #include "gtest/gtest.h"
@@ -38,3 +39,28 @@ TEST(Instance, sequence)
   goals.goal_indices = {2, 2};
   ASSERT_EQ(ins.goals, goals);
 }
+
+TEST(Instance, indexes_on_binary_graph)
+{
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto binary_filename =
+      (std::filesystem::temp_directory_path() / "lacam_test_instance.graph")
+          .string();
+  ASSERT_TRUE(Graph(map_filename).save_binary(binary_filename));
+
+  const auto ins = Instance(binary_filename, {0, 1}, {{1023, 31}, {31}});
+  ASSERT_EQ(ins.G.storage, Graph::Storage::MAPPED);
+  ASSERT_TRUE(ins.is_valid(0));
+  ASSERT_EQ(ins.starts[1]->index, 1);
+  ASSERT_EQ(ins.goal_sequences[0].front()->index, 1023);
+  ASSERT_EQ(ins.goals[1]->index, 31);
+
+  // out of range or blocked
+  const auto ins_invalid = Instance(binary_filename, std::vector<int>{0, -1},
+                                    std::vector<int>{1, 1024});
+  ASSERT_FALSE(ins_invalid.is_valid(0));
+  const auto ins_blocked = Instance(binary_filename, std::vector<int>{7},
+                                    std::vector<int>{1});
+  ASSERT_FALSE(ins_blocked.is_valid(0));
+  std::filesystem::remove(binary_filename);
+}
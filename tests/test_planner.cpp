@@ -1,6 +1,8 @@
 #include <lacam.hpp>
 #include <utils.hpp>
 
+#include <filesystem>
+
 #include "gtest/gtest.h"
 
 static bool VERBOSITY = 0;
@@ -265,3 +267,246 @@ TEST(planner, solver_duplicate_goal_end)
   ASSERT_TRUE(is_feasible_solution(ins, solution, VERBOSITY, threshold,
                                    allow_following));
 }
+
+TEST(planner, solve_twice)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 10);
+  ASSERT_TRUE(ins.is_valid(VERBOSITY));
+
+  // node storage is released after each search and reused by the next one
+  auto planner = Planner(&ins, nullptr, nullptr, VERBOSITY);
+  auto solution1 = planner.solve();
+  ASSERT_EQ(planner.NODES.size(), 0);
+  auto solution2 = planner.solve();
+  ASSERT_EQ(solution1, solution2);
+  ASSERT_TRUE(is_feasible_solution(ins, solution2, VERBOSITY, std::nullopt,
+                                   false));
+}
+
+TEST(planner, solve_twice_cached)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 10);
+  const auto dir =
+      std::filesystem::temp_directory_path() / "lacam_test_solve_cache";
+  std::filesystem::remove_all(dir);
+
+  // write back complete tables
+  auto solution = solve(ins, VERBOSITY, nullptr, nullptr, std::nullopt, false,
+                        Precompute::ALL_GOALS, 1, dir);
+
+  // the shared table maps them, and keeps them over the second solve
+  auto D = std::make_shared<DistTableMultiGoal>(ins);
+  for (auto k = 0; k < 2; ++k) {
+    auto solution_cached =
+        solve(ins, VERBOSITY, nullptr, nullptr, std::nullopt, false,
+              Precompute::NONE, 1, dir, false, D);
+    ASSERT_EQ(solution_cached, solution);
+    for (size_t i = 0; i < ins.N; ++i) {
+      ASSERT_TRUE(D->OPEN[D->table_ids[i][0]].empty());
+    }
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(planner, priorities)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 100);
+  const auto solution = solve(ins, VERBOSITY);
+  ASSERT_GT(solution.size(), 40);
+
+  // nodes along the solution, with reference priorities
+  auto planner = Planner(&ins, nullptr, nullptr, VERBOSITY);
+  std::vector<Node*> nodes;
+  std::vector<std::vector<float>> refs(solution.size());
+  for (size_t t = 0; t < solution.size(); ++t) {
+    const auto& C = solution[t];
+    auto parent = t == 0 ? nullptr : nodes.back();
+    nodes.push_back(planner.create_node(C, ConfigHasher()(C), parent,
+                                        t == 0 ? nullptr : &solution[t - 1]));
+    Node::set_priorities(C, *planner.D, t == 0 ? nullptr : &refs[t - 1],
+                         refs[t]);
+  }
+
+  // stored every snapshot_interval steps, others are rebuilt
+  const auto interval = planner.layout.snapshot_interval;
+  for (size_t t = 0; t < nodes.size(); ++t) {
+    ASSERT_EQ(nodes[t]->priorities.empty(), t % interval != 0);
+  }
+  for (auto t = (int)nodes.size() - 1; t >= 0; --t) {
+    ASSERT_EQ(planner.get_priorities(nodes[t]), refs[t]);
+  }
+
+  // also from the root, once stored ones are released
+  for (auto S : nodes) S->release();
+  ASSERT_EQ(planner.get_priorities(nodes[interval + 1]), refs[interval + 1]);
+}
+
+TEST(planner, constraint_chain)
+{
+  const auto map_filename = "./tests/assets/2x2.map";
+  const auto ins = Instance(map_filename, {0, 3}, {3, 0});
+
+  auto root = Constraint();
+  auto M1 = Constraint(&root, 1, ins.G.U[3]);
+  auto M2 = Constraint(&M1, 0, ins.G.U[1]);
+  ASSERT_EQ(root.depth, 0);
+  ASSERT_EQ(M2.depth, 2);
+  ASSERT_EQ(M2.parent, &M1);
+  ASSERT_EQ(M2.parent->who, 1);
+  ASSERT_EQ(M2.parent->where, ins.G.U[3]);
+  ASSERT_EQ(M2.parent->parent, &root);
+}
+
+TEST(planner, implicit_graph)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto N = 50;
+  const auto ins = Instance(scen_filename, map_filename, N);
+  const auto ins_implicit = Instance(scen_filename, map_filename, N, true);
+  ASSERT_TRUE(ins_implicit.is_valid(VERBOSITY));
+
+  const auto threshold = std::nullopt;
+  const auto allow_following = false;
+  auto solution = solve(ins, VERBOSITY, nullptr, nullptr, threshold);
+  auto solution_implicit =
+      solve(ins_implicit, VERBOSITY, nullptr, nullptr, threshold);
+  ASSERT_TRUE(is_feasible_solution(ins_implicit, solution_implicit, VERBOSITY,
+                                   threshold, allow_following));
+  ASSERT_EQ(solution.size(), solution_implicit.size());
+  for (size_t t = 0; t < solution.size(); ++t) {
+    for (size_t i = 0; i < N; ++i) {
+      ASSERT_EQ(solution[t][i]->id, solution_implicit[t][i]->id);
+    }
+  }
+}
+
+TEST(planner, roadmap)
+{
+  // the hub has degree six
+  const auto map_filename = "./tests/assets/star.roadmap";
+  const std::vector<int> starts = {7, 8, 9, 10, 11};
+  const std::vector<int> goals = {11, 10, 9, 8, 7};
+  const Instance ins(map_filename, starts, goals);
+  ASSERT_TRUE(ins.is_valid(VERBOSITY));
+
+  const auto threshold = std::nullopt;
+  const auto allow_following = false;
+  auto solution = solve(ins, VERBOSITY, nullptr, nullptr, threshold);
+  ASSERT_GT(solution.size(), 0);
+  ASSERT_TRUE(is_feasible_solution(ins, solution, VERBOSITY, threshold,
+                                   allow_following));
+}
+
+TEST(planner, portfolio)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto N = 100;
+  const auto ins = Instance(scen_filename, map_filename, N);
+
+  const auto threshold = std::nullopt;
+  const auto allow_following = true;
+  auto solution = solve_portfolio(ins, VERBOSITY, nullptr, 0, 4, threshold,
+                                  allow_following);
+  ASSERT_GT(solution.size(), 0);
+  ASSERT_TRUE(is_feasible_solution(ins, solution, VERBOSITY, threshold,
+                                   allow_following));
+
+  // cancelled planners stop immediately
+  std::atomic<bool> cancelled(true);
+  auto planner = Planner(&ins, nullptr, nullptr, VERBOSITY);
+  planner.cancel = &cancelled;
+  ASSERT_TRUE(planner.solve().empty());
+}
+
+TEST(planner, parallel_search)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto N = 200;
+  const auto ins = Instance(scen_filename, map_filename, N);
+  auto MT = std::mt19937(0);
+
+  for (auto allow_following : {false, true}) {
+    const auto threshold = std::nullopt;
+    auto solution =
+        solve(ins, VERBOSITY, nullptr, &MT, threshold, allow_following,
+              Precompute::NONE, 0, "", false, nullptr, 4);
+    ASSERT_GT(solution.size(), 0);
+    ASSERT_TRUE(is_feasible_solution(ins, solution, VERBOSITY, threshold,
+                                     allow_following));
+  }
+}
+
+TEST(planner, hint)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto N = 100;
+  auto ins = Instance(scen_filename, map_filename, N);
+  auto MT = std::mt19937(0);
+  auto planner = Planner(&ins, nullptr, &MT, VERBOSITY);
+  const auto solution = planner.solve();
+  ASSERT_GT(solution.size(), 5);
+
+  // the hint is followed as is, from the configuration equal to the starts
+  ins.starts = solution[5];
+  auto planner_hint = Planner(&ins, nullptr, nullptr, VERBOSITY);
+  planner_hint.hint = solution;
+  const auto solution_hint = planner_hint.solve();
+  ASSERT_EQ(solution_hint.size(), solution.size() - 5);
+  for (size_t t = 0; t < solution_hint.size(); ++t) {
+    ASSERT_EQ(solution_hint[t], solution[t + 5]);
+  }
+
+  // infeasible hints are skipped
+  auto hint = Solution(solution.begin() + 5, solution.end());
+  std::swap(hint[1][0], hint[1][1]);
+  planner_hint.hint = hint;
+  const auto solution_fallback = planner_hint.solve();
+  ASSERT_GT(solution_fallback.size(), 0);
+  ASSERT_TRUE(is_feasible_solution(ins, solution_fallback, VERBOSITY,
+                                   std::nullopt, false));
+
+  // malformed hints are dropped
+  for (auto k = 0; k < 2; ++k) {
+    auto hint_malformed = hint;
+    if (k == 0) hint_malformed[2] = Config({hint[2][0]});
+    if (k == 1) hint_malformed[2][0] = nullptr;
+    planner_hint.hint = hint_malformed;
+    const auto solution_dropped = planner_hint.solve();
+    ASSERT_TRUE(planner_hint.hint.empty());
+    ASSERT_TRUE(is_feasible_solution(ins, solution_dropped, VERBOSITY,
+                                     std::nullopt, false));
+  }
+}
+
+TEST(planner, anytime)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto N = 50;
+  const auto ins = Instance(scen_filename, map_filename, N);
+  auto MT = std::mt19937(0);
+  const auto deadline = Deadline(500);
+  auto planner = Planner(&ins, &deadline, &MT, VERBOSITY);
+  planner.anytime = true;
+  const auto solution = planner.solve();
+  ASSERT_TRUE(is_feasible_solution(ins, solution, VERBOSITY, std::nullopt,
+                                   false));
+
+  // costs of improved solutions decrease, the last one is returned
+  const auto& refinements = planner.refinements;
+  ASSERT_GT(refinements.size(), 1);
+  for (size_t k = 1; k < refinements.size(); ++k) {
+    ASSERT_LT(refinements[k].second, refinements[k - 1].second);
+  }
+  ASSERT_EQ(refinements.back().second, get_sum_of_loss(solution));
+}
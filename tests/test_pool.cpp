@@ -0,0 +1,25 @@
+#include <lacam.hpp>
+
+#include "gtest/gtest.h"
+
+TEST(Pool, create_and_clear)
+{
+  auto pool = Pool<std::vector<int>, 4>();
+  std::vector<std::vector<int>*> objs;
+  for (int k = 0; k < 10; ++k) objs.push_back(pool.create(k, k));
+  ASSERT_EQ(pool.size(), 10);
+  ASSERT_EQ(pool.capacity(), 12);
+  for (int k = 0; k < 10; ++k) ASSERT_EQ(objs[k]->size(), k);
+
+  // memory is reused after clear
+  pool.clear();
+  ASSERT_EQ(pool.size(), 0);
+  auto p = pool.create(3, 1);
+  ASSERT_EQ(p, objs[0]);
+  ASSERT_EQ(pool.capacity(), 12);
+
+  // the last one is reused right away
+  pool.destroy_last();
+  ASSERT_EQ(pool.size(), 0);
+  ASSERT_EQ(pool.create(2, 1), objs[0]);
+}
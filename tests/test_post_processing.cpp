@@ -1,3 +1,4 @@
+#include <filesystem>
 #include <lacam.hpp>
 
 #include "gtest/gtest.h"
@@ -123,3 +124,125 @@ TEST(PostProcessing, metrics)
   ASSERT_EQ(get_makespan(sol), 2);
   ASSERT_EQ(get_sum_of_costs(sol), 4);
 }
+
+TEST(PostProcessing, shared_dist_table)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 10);
+
+  // the planner fills the table handed over by the caller
+  auto dist_table = std::make_shared<DistTableMultiGoal>(ins);
+  auto solution = solve(ins, VERBOSITY, nullptr, nullptr, std::nullopt, false,
+                        Precompute::NONE, 0, "", false, dist_table);
+  ASSERT_GT(solution.size(), 0);
+  for (size_t i = 0; i < ins.N; ++i) {
+    const auto id = dist_table->table_ids[i][0];
+    ASSERT_LT(dist_table->read(id, ins.starts[i]->id), dist_table->K);
+  }
+
+  auto dist_table_new = DistTableMultiGoal(ins);
+  ASSERT_EQ(get_sum_of_costs_lower_bound(ins, *dist_table),
+            get_sum_of_costs_lower_bound(ins, dist_table_new));
+  ASSERT_EQ(get_makespan_lower_bound(ins, *dist_table),
+            get_makespan_lower_bound(ins, dist_table_new));
+}
+
+TEST(PostProcessing, validate_parallel)
+{
+  auto MT = std::mt19937(0);
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 50);
+  auto sol = solve(ins, VERBOSITY, nullptr, &MT);
+  ASSERT_GT(sol.size(), 4);
+  ASSERT_TRUE(
+      is_feasible_solution(ins, sol, VERBOSITY, std::nullopt, false, 4));
+
+  // vertex conflict in the middle
+  const auto t = sol.size() / 2;
+  sol[t][1] = sol[t][0];
+  ASSERT_FALSE(
+      is_feasible_solution(ins, sol, VERBOSITY, std::nullopt, true, 4));
+  ASSERT_FALSE(
+      is_feasible_solution(ins, sol, VERBOSITY, std::nullopt, true, 1));
+}
+
+TEST(PostProcessing, binary_solution)
+{
+  auto MT = std::mt19937(0);
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto ins = Instance(scen_filename, map_filename, 50);
+  const auto solution = solve(ins, VERBOSITY, nullptr, &MT);
+  ASSERT_GT(solution.size(), 64);
+
+  const auto filename =
+      (std::filesystem::temp_directory_path() / "lacam_solution.bin").string();
+  ASSERT_TRUE(save_solution(filename, ins, solution, 12.5, 3));
+  const auto reader = SolutionReader(filename);
+  ASSERT_TRUE(reader.is_valid);
+  ASSERT_EQ(reader.N, 50);
+  ASSERT_EQ(reader.T, (int)solution.size());
+  ASSERT_EQ(reader.seed, 3);
+
+  // random access around keyframes
+  std::vector<uint32_t> indexes;
+  for (int t : {0, 1, 63, 64, 65, reader.T - 1}) {
+    ASSERT_TRUE(reader.get(t, indexes));
+    for (auto i = 0; i < reader.N; ++i) {
+      ASSERT_EQ(indexes[i], (uint32_t)solution[t][i]->index);
+    }
+  }
+  ASSERT_FALSE(reader.get(reader.T, indexes));
+  const auto loaded = reader.load(ins.G);
+  ASSERT_EQ(loaded.size(), solution.size());
+  for (size_t t = 0; t < solution.size(); ++t) {
+    ASSERT_TRUE(std::equal(loaded[t].begin(), loaded[t].end(),
+                           solution[t].begin()));
+  }
+
+  // same paths as the text log
+  const auto log_filename = filename + ".txt";
+  const auto log_ref_filename = filename + ".ref.txt";
+  ASSERT_TRUE(
+      make_log_from_binary(filename, ins.G, log_filename, map_filename));
+  make_log(ins, solution, log_ref_filename, 12.5, map_filename, 3, false, true);
+  auto read_all = [](const std::string& name) {
+    std::ifstream file(name);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+  };
+  ASSERT_EQ(read_all(log_filename), read_all(log_ref_filename));
+  std::filesystem::remove(filename);
+  std::filesystem::remove(log_filename);
+  std::filesystem::remove(log_ref_filename);
+}
+
+TEST(PostProcessing, binary_solution_broken_moves)
+{
+  const auto map_filename = "./assets/empty-8-8.map";
+  const auto ins =
+      Instance(map_filename, std::vector<int>{0}, std::vector<int>{1});
+  const auto solution = Solution{Config({ins.G.U[0]}), Config({ins.G.U[1]})};
+  const auto filename =
+      (std::filesystem::temp_directory_path() / "lacam_broken.bin").string();
+  ASSERT_TRUE(save_solution(filename, ins, solution, 0, 0));
+  const auto size = std::filesystem::file_size(filename);
+
+  // LEFT at x = 0 and DOWN at y = 0 leave the grid, the last byte is the move
+  for (char code : {1, 4}) {
+    {
+      std::fstream file(filename,
+                        std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(size - 1);
+      file.put(code);
+    }
+    const auto reader = SolutionReader(filename);
+    ASSERT_TRUE(reader.is_valid);
+    std::vector<uint32_t> indexes;
+    ASSERT_FALSE(reader.get(1, indexes));
+    ASSERT_TRUE(reader.load(ins.G).empty());
+  }
+  std::filesystem::remove(filename);
+}
@@ -0,0 +1,42 @@
+#include <lacam.hpp>
+
+#include "gtest/gtest.h"
+
+static bool VERBOSITY = 0;
+
+TEST(Session, rounds)
+{
+  const auto scen_filename = "./assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "./assets/random-32-32-10.map";
+  const auto N = 50;
+  auto ins = Instance(scen_filename, map_filename, N);
+  auto MT = std::mt19937(0);
+  auto session = Session(&ins, VERBOSITY, &MT);
+
+  // each round reaches ten more goals, agents done receive new ones
+  auto C = ins.starts;
+  int reached = 0;
+  for (int round = 0; round < 5; ++round) {
+    for (auto i = 0; i < N; ++i) {
+      if (C.goal_indices[i] < (int)ins.goal_sequences[i].size()) continue;
+      session.append_goals(i, {ins.G.get_vertex(MT() % ins.G.size())});
+    }
+    auto solution = session.solve(C, 10);
+    ASSERT_GT(solution.size(), 0);
+    ASSERT_TRUE(
+        is_feasible_solution(ins, solution, VERBOSITY, reached + 10, false));
+    C = solution.back();
+    reached += 10;
+  }
+
+  // planner and distance tables persist
+  ASSERT_EQ(session.num_rounds, 5);
+  ASSERT_GT(session.planner->NODES.capacity(), 0);
+  ASSERT_LE(session.D->num_tables(), (size_t)N);
+
+  // the last round plans to the end of all sequences
+  auto solution = session.solve(C, std::nullopt);
+  ASSERT_GT(solution.size(), 0);
+  ASSERT_TRUE(
+      is_feasible_solution(ins, solution, VERBOSITY, std::nullopt, false));
+}
@@ -0,0 +1,129 @@
+/*
+ * microbenchmark of map/scenario parsers
+ * the regex-based parsers below are kept as the reference implementation
+ *
+ * usage: bench_parser [map_file] [scen_file] [repetitions]
+ */
+#include <lacam.hpp>
+
+// the former graph layout, separately allocated vertices
+struct RefVertex {
+  int id;
+  int index;
+  std::vector<RefVertex*> neighbor;
+};
+
+struct RefGraph {
+  std::vector<RefVertex*> V;
+  std::vector<RefVertex*> U;
+  int width = 0;
+  int height = 0;
+  ~RefGraph()
+  {
+    for (auto v : V) delete v;
+  }
+};
+
+// the former Graph(filename)
+static void regex_parse_map(const std::string& filename, RefGraph& G)
+{
+  static const std::regex r_height = std::regex(R"(height\s(\d+))");
+  static const std::regex r_width = std::regex(R"(width\s(\d+))");
+  static const std::regex r_map = std::regex(R"(map)");
+
+  std::ifstream file(filename);
+  if (!file) return;
+  std::string line;
+  std::smatch results;
+  auto& width = G.width;
+  auto& height = G.height;
+  while (getline(file, line)) {
+    if (!line.empty() && line.back() == 0x0d) line.pop_back();
+    if (std::regex_match(line, results, r_height)) {
+      height = std::stoi(results[1].str());
+    }
+    if (std::regex_match(line, results, r_width)) {
+      width = std::stoi(results[1].str());
+    }
+    if (std::regex_match(line, results, r_map)) break;
+  }
+  G.U = std::vector<RefVertex*>(width * height, nullptr);
+  int y = 0;
+  while (getline(file, line) && y < height) {
+    if (!line.empty() && line.back() == 0x0d) line.pop_back();
+    for (int x = 0; x < width && x < (int)line.size(); ++x) {
+      if (line[x] == 'T' || line[x] == '@') continue;
+      auto v = new RefVertex{(int)G.V.size(), width * y + x, {}};
+      G.V.push_back(v);
+      G.U[width * y + x] = v;
+    }
+    ++y;
+  }
+  for (auto v : G.V) {
+    const int x = v->index % width, y_v = v->index / width;
+    const int dx[] = {-1, 1, 0, 0}, dy[] = {0, 0, 1, -1};
+    for (int k = 0; k < 4; ++k) {
+      const int nx = x + dx[k], ny = y_v + dy[k];
+      if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+      auto u = G.U[width * ny + nx];
+      if (u != nullptr) v->neighbor.push_back(u);
+    }
+  }
+}
+
+static int regex_parse_scen(const std::string& filename)
+{
+  static const std::regex r_instance = std::regex(
+      R"(\d+\t.+\.map\t\d+\t\d+\t(\d+)\t(\d+)\t(\d+)\t(\d+)\t.+)");
+
+  std::ifstream file(filename);
+  if (!file) return -1;
+  std::string line;
+  std::smatch results;
+  int num_agents = 0;
+  while (getline(file, line)) {
+    if (!line.empty() && line.back() == 0x0d) line.pop_back();
+    if (std::regex_match(line, results, r_instance)) ++num_agents;
+  }
+  return num_agents;
+}
+
+template <typename F>
+static double measure(int repetitions, F f)
+{
+  const auto deadline = Deadline();
+  for (int k = 0; k < repetitions; ++k) f();
+  return deadline.elapsed_ms() / repetitions;
+}
+
+int main(int argc, char* argv[])
+{
+  const std::string map_name =
+      argc > 1 ? argv[1] : "./assets/random-32-32-10.map";
+  const std::string scen_name =
+      argc > 2 ? argv[2] : "./assets/random-32-32-10-random-1.scen";
+  const int repetitions = argc > 3 ? std::atoi(argv[3]) : 100;
+
+  int ref_vertices = 0, ref_agents = 0, num_vertices = 0, num_agents = 0;
+  const auto t_regex_map = measure(repetitions, [&]() {
+    auto G = RefGraph();
+    regex_parse_map(map_name, G);
+    ref_vertices = G.V.size();
+  });
+  const auto t_regex_scen = measure(
+      repetitions, [&]() { ref_agents = regex_parse_scen(scen_name); });
+  const auto t_map = measure(repetitions, [&]() {
+    num_vertices = Graph(map_name).size();
+  });
+  const auto t_scen = measure(repetitions, [&]() {
+    num_agents = Instance(scen_name, map_name, ref_agents).starts.size();
+  });
+
+  std::cout << "map:  regex " << t_regex_map << " ms, new " << t_map
+            << " ms, |V|=" << num_vertices << " (ref " << ref_vertices << ")"
+            << std::endl;
+  std::cout << "scen: regex " << t_regex_scen << " ms, new " << t_scen
+            << " ms (new incl. map), agents=" << num_agents << " (ref "
+            << ref_agents << ")" << std::endl;
+  return (num_vertices == ref_vertices) ? 0 : 1;
+}
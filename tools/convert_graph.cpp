@@ -0,0 +1,41 @@
+/*
+ * conversion of map files to the binary graph format
+ * the output can be given to main as the map, e.g., -m random-32-32-10.graph
+ *
+ * usage: convert_graph <map_file> <output_file>
+ */
+#include <lacam.hpp>
+
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cerr << "usage: " << argv[0] << " <map_file> <output_file>"
+              << std::endl;
+    return 1;
+  }
+  const std::string map_name = argv[1];
+  const std::string output_name = argv[2];
+
+  // the implicit mode is enough to enumerate vertices and edges
+  auto deadline = Deadline();
+  const auto G = Graph(map_name, true);
+  if (G.size() == 0) return 1;
+  if (!G.save_binary(output_name)) {
+    std::cerr << "failed to write " << output_name << std::endl;
+    return 1;
+  }
+  const auto elapsed_convert = deadline.elapsed_ms();
+
+  // validation
+  const auto t_s = Deadline();
+  const auto G_binary = Graph(output_name);
+  const auto elapsed_load = t_s.elapsed_ms();
+  if (G_binary.size() != G.size() || G_binary.get_hash() != G.get_hash()) {
+    std::cerr << "validation failed" << std::endl;
+    return 1;
+  }
+  std::cout << output_name << ": " << G.width << "x" << G.height
+            << ", |V|=" << G.size() << ", converted in " << elapsed_convert
+            << " ms, loaded in " << elapsed_load << " ms" << std::endl;
+  return 0;
+}
@@ -0,0 +1,27 @@
+/*
+ * conversion of binary solution files to the text log, e.g., for visualizer
+ * binary solutions are written by main with --binary_output
+ *
+ * usage: convert_solution <map_file> <solution_file> <output_file>
+ */
+#include <lacam.hpp>
+
+int main(int argc, char* argv[])
+{
+  if (argc != 4) {
+    std::cerr << "usage: " << argv[0]
+              << " <map_file> <solution_file> <output_file>" << std::endl;
+    return 1;
+  }
+  const std::string map_name = argv[1];
+  const std::string solution_name = argv[2];
+  const std::string output_name = argv[3];
+
+  const auto G = Graph(map_name);
+  if (G.size() == 0) return 1;
+  if (!make_log_from_binary(solution_name, G, output_name, map_name)) {
+    std::cerr << "failed to convert " << solution_name << std::endl;
+    return 1;
+  }
+  return 0;
+}